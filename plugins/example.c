@@ -0,0 +1,53 @@
+// Example plugin: the usual directions and attacks, and while LEFT_THUMB_2 is held every attack is plinked, pressed for
+// one report, let go for _PLINK_GAP and then held normally. Built as example_plugin.bin by CMakeLists.txt here.
+// tools/plugin_image/example.s is a hand written copy for cycle_bench, keep the two doing the same.
+
+#include "src/plugin_abi.h"
+
+// Attacks are the top and bottom rows
+#define _FIRST_ATTACK BUTTON_TOP_1
+#define _PLINK_PIN BUTTON_LEFT_THUMB_2
+// Report ticks the attack is released between the two presses
+#define _PLINK_GAP 2
+
+typedef struct {
+    u32 plink_tick[8];
+    u8 plinking;
+} _State;
+
+static void _task(Profile *self) {
+    const PluginApi *api = plugin_context(self)->api;
+    _State *state = (_State *) plugin_context(self)->state;
+    u32 tick = api->report_tick();
+
+    api->bind(BUTTON_RING, LEFT);
+    api->bind(BUTTON_MIDDLE, DOWN);
+    api->bind(BUTTON_INDEX, RIGHT);
+    api->bind(BUTTON_LEFT_THUMB_1, UP);
+
+    for (int i = 0; i < 8; ++i) {
+        int pin = _FIRST_ATTACK + i;
+
+        if (api->button_pressed(pin) && api->button_down(_PLINK_PIN)) {
+            state->plink_tick[i] = tick;
+            state->plinking |= 1u << i;
+        }
+
+        if (state->plinking & (1u << i)) {
+            u32 age = tick - state->plink_tick[i];
+
+            if (age > _PLINK_GAP) {
+                state->plinking &= ~(1u << i);
+            }
+            else {
+                // The output changes with time alone until the plink is over
+                api->request_update();
+                if (age > 0) continue;
+            }
+        }
+
+        api->bind(pin, ATTACK_1 + i);
+    }
+}
+
+PLUGIN("plink", _task, SOCD_NEUTRAL, MODE_GAMEPAD, sizeof(_State));
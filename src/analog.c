@@ -0,0 +1,70 @@
+#include "analog.h"
+
+static void _set_range(AnalogChannel *channel, u16 bottom) {
+    channel->bottom = bottom;
+
+    u32 range = bottom > channel->rest ? bottom - channel->rest : channel->rest - bottom;
+    if (range == 0) range = 1;
+    channel->scale = ((u32) ANALOG_TRAVEL_MAX << 16) / range;
+}
+
+void analog_init(AnalogChannel *channel, const AnalogConfig *config, u16 rest, i32 range) {
+    i32 bottom = (i32) rest + range;
+    if (bottom < 0) bottom = 0;
+    if (bottom > 0xFFFF) bottom = 0xFFFF;
+
+    channel->config = *config;
+    channel->rest = rest;
+    _set_range(channel, (u16) bottom);
+
+    channel->travel = 0;
+    channel->extreme = 0;
+    channel->down = false;
+}
+
+static u16 _travel(AnalogChannel *channel, u16 raw) {
+    bool inverted = channel->bottom < channel->rest;
+
+    // Readings on the wrong side of rest are noise at the top of the travel
+    if (inverted ? raw >= channel->rest : raw <= channel->rest) return 0;
+
+    // Pushed past the calibrated bottom, widen the range
+    if (inverted ? raw < channel->bottom : raw > channel->bottom) _set_range(channel, raw);
+
+    u32 delta = inverted ? channel->rest - raw : raw - channel->rest;
+    u32 travel = (delta * channel->scale) >> 16;
+    return travel > ANALOG_TRAVEL_MAX ? ANALOG_TRAVEL_MAX : (u16) travel;
+}
+
+bool analog_update(AnalogChannel *channel, u16 raw) {
+    const AnalogConfig *config = &channel->config;
+    bool rapid = config->rapid_press != 0;
+
+    u16 travel = _travel(channel, raw);
+    channel->travel = travel;
+
+    if (channel->down) {
+        if (travel > channel->extreme) channel->extreme = travel;
+
+        bool left_zone = (i32) travel + config->hysteresis < config->actuation;
+        bool reversed = rapid && (i32) travel + config->rapid_release <= channel->extreme;
+
+        if (left_zone || reversed) {
+            channel->down = false;
+            channel->extreme = travel;
+        }
+    }
+    else {
+        if (travel < channel->extreme) channel->extreme = travel;
+
+        bool in_zone = travel >= config->actuation;
+        bool moved = !rapid || travel >= (i32) channel->extreme + config->rapid_press;
+
+        if (in_zone && moved) {
+            channel->down = true;
+            channel->extreme = travel;
+        }
+    }
+
+    return channel->down;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+// Decision logic for analog (hall effect) buttons. Turns filtered adc readings into a pressed state using fixed
+// point math only, so it runs the same on the pico and on the host (see tools/analog_replay.c).
+//
+// Travel is measured in 1/ANALOG_TRAVEL_MAX of the full key travel. A key presses when it passes the actuation
+// point. With rapid trigger it also releases as soon as it moves back up by rapid_release, and presses again as
+// soon as it moves down by rapid_press, anywhere below the actuation point. Without it a key releases once it
+// rises hysteresis above the actuation point.
+
+#include "common.h"
+
+#define ANALOG_TRAVEL_MAX 1024
+
+typedef struct {
+    u16 actuation;
+    u16 hysteresis;
+    // 0 disables rapid trigger
+    u16 rapid_press;
+    u16 rapid_release;
+} AnalogConfig;
+
+typedef struct {
+    AnalogConfig config;
+
+    // Raw readings at rest and at the bottom of the travel. bottom may be below rest depending on the magnet
+    // polarity. The range widens on its own when the key is pushed further than bottom.
+    u16 rest;
+    u16 bottom;
+    // Travel per raw unit in 16.16 fixed point, derived from rest and bottom
+    u32 scale;
+
+    u16 travel;
+    // Lowest travel since the last release, or highest since the last press
+    u16 extreme;
+    bool down;
+} AnalogChannel;
+
+// rest is a reading taken with the key released. range is the expected raw distance from rest to the bottom,
+// negative if the reading drops when the key is pressed.
+void analog_init(AnalogChannel *channel, const AnalogConfig *config, u16 rest, i32 range);
+
+// Feeds one filtered reading and returns whether the key is down
+bool analog_update(AnalogChannel *channel, u16 raw);
@@ -1,10 +1,12 @@
 #include "settings.h"
+#include "plugin.h"
 
 #include "profiles/default.h"
 #include "profiles/ggst.h"
 
 static int _id_default = INVALID_ID;
 static int _id_ggst = INVALID_ID;
+static int _id_plugin = INVALID_ID;
 
 static bool _save_power = true;
 
@@ -15,6 +17,10 @@ static void _init_profiles(void) {
 
     Profile p_ggst = create_ggst_profile();
     _id_ggst = register_profile(p_ggst);
+
+    // Runs whatever plugin was uploaded last, see plugin.h
+    Profile p_plugin = create_plugin_profile();
+    _id_plugin = register_profile(p_plugin);
     
     // Set the default profile
     select_profile(_id_default);
@@ -24,35 +30,38 @@ static void _user_task_callback(void) {
     static bool core_util_button_consumed = false;
 
     // Handle switching profiles
-    if (button_down(28) && button_released(17)) { select_profile(_id_default); return; }
-    if (button_down(28) && button_released(18)) { select_profile(_id_ggst);    return; }
-    if (button_down(28) && button_released(19)) { select_profile(INVALID_ID);  return; }
-    if (button_down(28) && button_released(20)) { select_profile(INVALID_ID);  return; }
-    if (button_down(28) && button_released(21)) { select_profile(INVALID_ID);  return; }
-    if (button_down(28) && button_released(22)) { select_profile(INVALID_ID);  return; }
-    if (button_down(28) && button_released(26)) { select_profile(INVALID_ID);  return; }
-    if (button_down(28) && button_released(27)) { select_profile(INVALID_ID);  return; }
+    if (button_down(BUTTON_HOME) && button_released(BUTTON_F1)) { select_profile(_id_default); return; }
+    if (button_down(BUTTON_HOME) && button_released(BUTTON_F2)) { select_profile(_id_ggst);    return; }
+    if (button_down(BUTTON_HOME) && button_released(BUTTON_F3)) { select_profile(_id_plugin);  return; }
+    if (button_down(BUTTON_HOME) && button_released(BUTTON_F4)) { select_profile(INVALID_ID);  return; }
+    if (button_down(BUTTON_HOME) && button_released(BUTTON_F5)) { select_profile(INVALID_ID);  return; }
+    if (button_down(BUTTON_HOME) && button_released(BUTTON_F6)) { select_profile(INVALID_ID);  return; }
+    if (button_down(BUTTON_HOME) && button_released(BUTTON_F7)) { select_profile(INVALID_ID);  return; }
+    if (button_down(BUTTON_HOME) && button_released(BUTTON_F8)) { select_profile(INVALID_ID);  return; }
 
     Profile *profile = get_active_profile();
+
+    // The filter of a newly selected profile applies from the next scan on
+    platform_set_input_filter(profile ? profile->filter : NULL);
     if (profile == NULL) return;
 
     // Handle switching between the 4 socd settings
     core_util_button_consumed = false;
-    if (button_down(16) && button_released(17)) { profile->socd = SOCD_NATURAL; core_util_button_consumed = true; return; }
-    if (button_down(16) && button_released(18)) { profile->socd = SOCD_NEUTRAL; core_util_button_consumed = true; return; }
-    if (button_down(16) && button_released(19)) { profile->socd = SOCD_ABSOLUTE; core_util_button_consumed = true; return; }
-    if (button_down(16) && button_released(20)) { profile->socd = SOCD_LAST_INPUT; core_util_button_consumed = true; return; }
+    if (button_down(BUTTON_MOD) && button_released(BUTTON_F1)) { profile->socd = SOCD_NATURAL; core_util_button_consumed = true; return; }
+    if (button_down(BUTTON_MOD) && button_released(BUTTON_F2)) { profile->socd = SOCD_NEUTRAL; core_util_button_consumed = true; return; }
+    if (button_down(BUTTON_MOD) && button_released(BUTTON_F3)) { profile->socd = SOCD_ABSOLUTE; core_util_button_consumed = true; return; }
+    if (button_down(BUTTON_MOD) && button_released(BUTTON_F4)) { profile->socd = SOCD_LAST_INPUT; core_util_button_consumed = true; return; }
 
     // Handle input mode switching
-    if (button_down(16) && button_released(21)) { profile->mode = MODE_KEYBOARD; core_util_button_consumed = true; return; }
-    if (button_down(16) && button_released(22)) { profile->mode = MODE_GAMEPAD; core_util_button_consumed = true; return; }
-    if (button_down(16) && button_released(26)) { profile->mode = 0; core_util_button_consumed = true; return; }
-    if (button_down(16) && button_released(27)) { profile->mode = 0; core_util_button_consumed = true; return; }
+    if (button_down(BUTTON_MOD) && button_released(BUTTON_F5)) { profile->mode = MODE_KEYBOARD; core_util_button_consumed = true; return; }
+    if (button_down(BUTTON_MOD) && button_released(BUTTON_F6)) { profile->mode = MODE_GAMEPAD; core_util_button_consumed = true; return; }
+    if (button_down(BUTTON_MOD) && button_released(BUTTON_F7)) { profile->mode = 0; core_util_button_consumed = true; return; }
+    if (button_down(BUTTON_MOD) && button_released(BUTTON_F8)) { profile->mode = 0; core_util_button_consumed = true; return; }
     
-    if (button_down(16)) return;
+    if (button_down(BUTTON_MOD)) return;
 
     // Toggle power saving mode for debug purposes
-    // if (!core_util_button_consumed && button_released(16)) { _save_power = !_save_power; return; }
+    // if (!core_util_button_consumed && button_released(BUTTON_MOD)) { _save_power = !_save_power; return; }
 
     // Update the platform mode because the profile might have changed or been updated
     profile->task(profile);
@@ -61,11 +70,18 @@ static void _user_task_callback(void) {
         platform_set_mode(profile->mode);
     }
 
-    send_inputs(profile->socd);
+    u8 polling = profile->polling_ms ? profile->polling_ms : POLLING_RATE;
+    if (platform_get_polling() != polling) {
+        platform_set_polling(polling);
+    }
+
+    if (profile->send) profile->send(profile);
+    else send_inputs(profile->socd, profile->keymap);
 }
 
 int main(void) {
-    platform_init();
+    platform_init(NULL);
+    // The first report is built by a profile, so they are loaded before the first scan rather than deferred
     _init_profiles();
 
     for (;;) {
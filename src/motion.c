@@ -0,0 +1,51 @@
+#include "motion.h"
+
+_Static_assert(MOTION_MAX_PATTERNS <= 8, "Accepted patterns are stored in an 8 bit mask");
+_Static_assert(MOTION_MAX_STATES <= 256, "States are stored in 8 bits");
+_Static_assert(MOTION_HISTORY > MOTION_MAX_LENGTH, "The history has to hold a whole motion and its charge");
+
+void motion_reset(MotionState *state) {
+    memset(state, 0, sizeof(*state));
+    state->direction = 5;
+}
+
+// Slot of the change back changes before the latest one
+static inline u8 _slot(const MotionState *state, u8 back) {
+    return (u8) ((state->head + MOTION_HISTORY - 1 - back) % MOTION_HISTORY);
+}
+
+static bool _check(const MotionTable *table, const MotionState *state, u8 pattern, u32 tick) {
+    u8 length = table->length[pattern];
+    if (!table->charge[pattern]) return tick - state->ticks[_slot(state, length - 1)] <= table->window[pattern];
+
+    // The window starts when the charge is let go
+    u32 released = state->ticks[_slot(state, length - 2)];
+    if (tick - released > table->window[pattern]) return false;
+
+    // The charge started with the earliest change of the unbroken run of charging directions
+    u16 charging = table->charge_class[pattern];
+    u8 back = length - 1;
+    while (back + 1 < state->count && (charging & (1u << state->history[_slot(state, back + 1)]))) back += 1;
+
+    return released - state->ticks[_slot(state, back)] >= table->charge[pattern];
+}
+
+u8 motion_step(const MotionTable *table, MotionState *state, u8 direction, u32 tick) {
+    if (direction == state->direction || direction < 1 || direction > 9) return 0;
+
+    state->direction = direction;
+    state->history[state->head] = direction;
+    state->ticks[state->head] = tick;
+    state->head = (state->head + 1) % MOTION_HISTORY;
+    if (state->count < MOTION_HISTORY) state->count += 1;
+
+    state->state = table->next[state->state][direction - 1];
+
+    u8 matched = 0;
+    for (u8 candidates = table->accept[state->state]; candidates; candidates &= candidates - 1) {
+        u8 pattern = (u8) __builtin_ctz(candidates);
+        if (_check(table, state, pattern, tick)) matched |= 1u << pattern;
+    }
+
+    return matched;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+// Motion input recognition over the resolved direction stream, in numpad notation (1-9, 5 is neutral).
+// All patterns are combined into one automaton over the direction changes, so every change costs a single table
+// step no matter how many patterns there are. It runs the same on the pico and on the host (see tools/motion_replay.c).
+//
+// A motion matches when its directions are the latest direction changes, in order and with nothing in between,
+// and the first of them came at most window ticks before the last. A charge motion also needs its first direction
+// held for charge ticks before the next one, where any direction that includes it counts (1, 4 and 7 all charge 4).
+
+#include "common.h"
+#include "settings.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Direction changes remembered for the window and charge checks
+#define MOTION_HISTORY 16
+
+typedef struct {
+    // Numpad digits, e.g. "236". At most MOTION_MAX_LENGTH.
+    const char *directions;
+    // Ticks allowed from the first direction to the last, counted from the end of the charge for charge motions.
+    // 0 uses MOTION_WINDOW_TICKS.
+    u16 window;
+    // Ticks the first direction has to be held, 0 for a plain motion. Needs at least two directions.
+    u16 charge;
+} MotionPattern;
+
+typedef struct {
+    u8 state_count;
+    u8 pattern_count;
+    // Indexed by state and direction - 1
+    u8 next[MOTION_MAX_STATES][9];
+    // Patterns whose directions end at each state
+    u8 accept[MOTION_MAX_STATES];
+
+    u8 length[MOTION_MAX_PATTERNS];
+    u16 window[MOTION_MAX_PATTERNS];
+    u16 charge[MOTION_MAX_PATTERNS];
+    // Directions that keep each charge going, bit n is direction n
+    u16 charge_class[MOTION_MAX_PATTERNS];
+} MotionTable;
+
+typedef struct {
+    u8 state;
+    u8 direction;
+    // Ring of the latest direction changes, head is the next slot
+    u8 head;
+    u8 count;
+    u8 history[MOTION_HISTORY];
+    u32 ticks[MOTION_HISTORY];
+} MotionState;
+
+void motion_reset(MotionState *state);
+
+// Feeds the direction of the current frame. Returns a mask of the patterns completed by it, only ever non zero on
+// the frame the direction changes.
+u8 motion_step(const MotionTable *table, MotionState *state, u8 direction, u32 tick);
+
+// The builder is in the header so profile definitions can run it at compile time and keep the table in flash, see
+// profile_builder.hpp. From C it is a plain function.
+#ifdef __cplusplus
+#define MOTION_CONSTEXPR constexpr
+#else
+#define MOTION_CONSTEXPR
+#endif
+
+static inline MOTION_CONSTEXPR int _motion_x(u8 direction) { return (direction - 1) % 3 - 1; }
+static inline MOTION_CONSTEXPR int _motion_y(u8 direction) { return (direction - 1) / 3 - 1; }
+
+// Directions that include every component of direction, the ones that keep a charge going. Bit n is direction n.
+static inline MOTION_CONSTEXPR u16 _motion_charge_class(u8 direction) {
+    u16 result = 0;
+    for (u8 d = 1; d <= 9; ++d) {
+        bool x = _motion_x(direction) == 0 || _motion_x(d) == _motion_x(direction);
+        bool y = _motion_y(direction) == 0 || _motion_y(d) == _motion_y(direction);
+        if (x && y) result |= 1u << d;
+    }
+    return result;
+}
+
+// Adds a path to the trie, state 0 is the root so 0 also means no child yet
+static inline MOTION_CONSTEXPR bool _motion_insert(MotionTable *table, const char *directions, u8 first, u8 length,
+                                                   u8 pattern) {
+    u8 state = 0;
+    for (u8 i = 0; i < length; ++i) {
+        u8 direction = i == 0 ? first : (u8) (directions[i] - '0');
+        u8 *next = &table->next[state][direction - 1];
+
+        if (*next == 0) {
+            if (table->state_count == MOTION_MAX_STATES) return false;
+            *next = table->state_count++;
+        }
+        state = *next;
+    }
+
+    table->accept[state] |= 1u << pattern;
+    return true;
+}
+
+// Returns false if a pattern is invalid or the patterns need more than MOTION_MAX_STATES states
+static inline MOTION_CONSTEXPR bool motion_build(MotionTable *table, const MotionPattern *patterns, u8 count) {
+    const MotionTable empty = {0};
+    *table = empty;
+    table->state_count = 1;
+    if (count > MOTION_MAX_PATTERNS) return false;
+
+    for (u8 p = 0; p < count; ++p) {
+        const MotionPattern *pattern = &patterns[p];
+
+        u8 length = 0;
+        while (pattern->directions && pattern->directions[length] && length <= MOTION_MAX_LENGTH) length += 1;
+        if (length == 0 || length > MOTION_MAX_LENGTH) return false;
+        if (pattern->charge && (length < 2 || pattern->directions[0] == '5')) return false;
+
+        for (u8 i = 0; i < length; ++i) {
+            if (pattern->directions[i] < '1' || pattern->directions[i] > '9') return false;
+        }
+
+        table->length[p] = length;
+        table->window[p] = pattern->window ? pattern->window : MOTION_WINDOW_TICKS;
+        table->charge[p] = pattern->charge;
+
+        // A charge can end on any direction that includes the charged one, so each of them gets its own path
+        u8 first = (u8) (pattern->directions[0] - '0');
+        u16 starts = pattern->charge ? _motion_charge_class(first) : (u16) (1u << first);
+        table->charge_class[p] = pattern->charge ? starts : 0;
+        for (u8 d = 1; d <= 9; ++d) {
+            if ((starts & (1u << d)) && !_motion_insert(table, pattern->directions, d, length, p)) return false;
+        }
+    }
+    table->pattern_count = count;
+
+    // Breadth first so the fallback of every state is complete before the deeper states use it
+    u8 fallback[MOTION_MAX_STATES] = {0};
+    u8 queue[MOTION_MAX_STATES] = {0};
+    u8 head = 0, tail = 0;
+
+    for (u8 d = 0; d < 9; ++d) {
+        if (table->next[0][d]) queue[tail++] = table->next[0][d];
+    }
+
+    while (head < tail) {
+        u8 state = queue[head++];
+        table->accept[state] |= table->accept[fallback[state]];
+
+        for (u8 d = 0; d < 9; ++d) {
+            u8 child = table->next[state][d];
+            if (child) {
+                fallback[child] = table->next[fallback[state]][d];
+                queue[tail++] = child;
+            }
+            else {
+                table->next[state][d] = table->next[fallback[state]][d];
+            }
+        }
+    }
+
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
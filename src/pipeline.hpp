@@ -0,0 +1,225 @@
+#pragma once
+
+// The path from the switches to the report as a chain of stages, composed at compile time per profile:
+//
+//     physical filters -> mapping -> virtual filters -> encoder
+//
+// Physical filters run on every scan before the inputs are latched (platform_set_input_filter), so button_down, the
+// temporal history and the hotkeys all see the filtered state. The mapping is the profile task, it presses virtual
+// buttons from the physical ones. Virtual filters reshape the held virtual buttons once they have been timestamped
+// and the encoder writes them into the report of the current mode. A stage whose output changes later without new
+// input asks for that frame itself with platform_request_update, the physical filters run on every scan anyway.
+//
+//     using _Pipeline = Pipeline<Debounce<DEBOUNCE_US>, ProfileMapping<_definition>, Turbo, Socd, ReportEncoder>;
+//     Profile create_my_profile(void) { return make_pipeline_profile<_Pipeline>(); }
+//
+// make_profile<definition>() is that pipeline without the debounce. Every stage call is resolved at compile time,
+// a profile costs one indirect call per scan for its physical filters and one each for the mapping and the output.
+//
+// A stage is a type with
+//
+//     static constexpr PipelineStageKind kind;
+//     struct State;                         // whatever it keeps between frames, empty for stateless stages
+//     static void run(State &state, PipelineFrame &frame);
+//
+// The States of the stages are reserved in the profile's block of the profile arena, after the mapping's own state,
+// and follow the mapping's state policy. tools/pipeline_bench runs a pipeline or any part of it against an input
+// script.
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "profile.h"
+#include "settings.h"
+#include "virtual_button.h"
+
+typedef enum {
+    PIPELINE_PHYSICAL,
+    PIPELINE_MAPPING,
+    PIPELINE_VIRTUAL,
+    PIPELINE_ENCODER,
+} PipelineStageKind;
+
+struct PipelineFrame {
+    // The profile that owns the pipeline
+    Profile *profile;
+    u32 now_us;
+    // Physical inputs, what the physical filters work on
+    InputMask inputs;
+    // Held virtual buttons, what the virtual filters and the encoder work on
+    u64 buttons;
+};
+
+template <typename... Stages>
+constexpr bool pipeline_in_order() {
+    PipelineStageKind kinds[] = { PIPELINE_PHYSICAL, Stages::kind... };
+    for (size_t i = 1; i < sizeof...(Stages) + 1; ++i) {
+        if (kinds[i] < kinds[i - 1]) return false;
+    }
+    return true;
+}
+
+// Size of the state the mapping stage reserves itself, 0 for the other stages
+template <typename Stage>
+constexpr u16 pipeline_mapping_state_size() {
+    if constexpr (Stage::kind == PIPELINE_MAPPING) return Stage::state_size;
+    else return 0;
+}
+
+template <typename... Stages>
+struct Pipeline {
+    static_assert(sizeof...(Stages) > 0, "A pipeline needs at least one stage");
+    static_assert(pipeline_in_order<Stages...>(), "Stages go physical filters, mapping, virtual filters, encoder");
+
+    using State = std::tuple<typename Stages::State...>;
+    static_assert(alignof(State) <= PROFILE_STATE_ALIGN, "Pipeline state is aligned beyond the profile arena");
+
+    // The stage states follow the mapping's state in the profile's block
+    static constexpr u16 mapping_state_size = (pipeline_mapping_state_size<Stages>() + ...);
+    static constexpr u16 state_offset = (mapping_state_size + alignof(State) - 1) & ~(alignof(State) - 1);
+    static constexpr u16 state_size = std::is_empty_v<State> ? mapping_state_size : state_offset + sizeof(State);
+    static_assert(state_size <= PROFILE_ARENA_SIZE, "Pipeline state doesn't fit in the profile arena");
+
+    template <PipelineStageKind kind>
+    static constexpr int count() {
+        return ((Stages::kind == kind ? 1 : 0) + ...);
+    }
+
+    // Runs the stages of one kind in order
+    template <PipelineStageKind kind>
+    static void run(PipelineFrame &frame) {
+        _run<kind>(frame, std::index_sequence_for<Stages...>());
+    }
+
+    // The profile the mapping stage describes, with room for the stage states
+    static Profile base_profile() {
+        Profile profile = {};
+        (_base_profile<Stages>(profile), ...);
+        profile.state_size = state_size;
+        return profile;
+    }
+
+private:
+    template <PipelineStageKind kind, size_t... index>
+    static void _run(PipelineFrame &frame, std::index_sequence<index...>) {
+        (_run_stage<kind, Stages, index>(frame), ...);
+    }
+
+    template <PipelineStageKind kind, typename Stage, size_t index>
+    static void _run_stage(PipelineFrame &frame) {
+        if constexpr (Stage::kind != kind) {
+            return;
+        }
+        else if constexpr (std::is_empty_v<typename Stage::State>) {
+            typename Stage::State state;
+            Stage::run(state, frame);
+        }
+        else {
+            auto *state = reinterpret_cast<State *>(static_cast<u8 *>(frame.profile->state) + state_offset);
+            Stage::run(std::get<index>(*state), frame);
+        }
+    }
+
+    template <typename Stage>
+    static void _base_profile(Profile &profile) {
+        if constexpr (Stage::kind == PIPELINE_MAPPING) profile = Stage::profile();
+    }
+};
+
+template <typename P>
+InputMask pipeline_filter(InputMask inputs, u32 scan_us) {
+    // The scan after a profile switch can still run the filter of the profile before, whose state is gone
+    Profile *profile = get_active_profile();
+    if (!profile || profile->filter != pipeline_filter<P>) return inputs;
+
+    PipelineFrame frame = { profile, scan_us, inputs, 0 };
+    P::template run<PIPELINE_PHYSICAL>(frame);
+    return frame.inputs;
+}
+
+template <typename P>
+void pipeline_task(Profile *self) {
+    PipelineFrame frame = { self, platform_time_us(), button_mask(), 0 };
+    P::template run<PIPELINE_MAPPING>(frame);
+}
+
+template <typename P>
+void pipeline_send(Profile *self) {
+    PipelineFrame frame = { self, platform_time_us(), button_mask(), latch_inputs() };
+    P::template run<PIPELINE_VIRTUAL>(frame);
+    P::template run<PIPELINE_ENCODER>(frame);
+}
+
+template <typename P>
+Profile make_pipeline_profile() {
+    static_assert(P::template count<PIPELINE_MAPPING>() == 1, "A profile pipeline needs exactly one mapping stage");
+    static_assert(P::template count<PIPELINE_ENCODER>() == 1, "A profile pipeline needs exactly one encoder stage");
+
+    Profile profile = P::base_profile();
+    profile.task = pipeline_task<P>;
+    profile.send = pipeline_send<P>;
+    profile.filter = P::template count<PIPELINE_PHYSICAL>() > 0 ? pipeline_filter<P> : nullptr;
+    return profile;
+}
+
+// An edge goes through at once and the input then ignores changes for window_us, so presses aren't delayed and
+// the bounce after them is dropped. A change still pending when the window ends goes through on that scan.
+template <u32 window_us>
+struct Debounce {
+    static constexpr PipelineStageKind kind = PIPELINE_PHYSICAL;
+
+    struct State {
+        InputMask output;
+        InputMask locked;
+        u32 until_us[INPUT_COUNT];
+    };
+
+    static void run(State &state, PipelineFrame &frame) {
+        for (InputMask locked = state.locked; locked; locked &= locked - 1) {
+            int pin = __builtin_ctzll(locked);
+            if ((i32)(frame.now_us - state.until_us[pin]) >= 0) state.locked &= ~INPUT_BIT(pin);
+        }
+
+        InputMask changed = (frame.inputs ^ state.output) & ~state.locked;
+        state.output ^= changed;
+        state.locked |= changed;
+        for (; changed; changed &= changed - 1) state.until_us[__builtin_ctzll(changed)] = frame.now_us + window_us;
+
+        frame.inputs = state.output;
+    }
+};
+
+// The turbo patterns declared by the mapping, see turbo(). The phases are kept with the declarations.
+struct Turbo {
+    static constexpr PipelineStageKind kind = PIPELINE_VIRTUAL;
+
+    struct State {};
+
+    static void run(State &, PipelineFrame &frame) {
+        frame.buttons = apply_turbo(frame.buttons);
+    }
+};
+
+// Resolves opposing directions with the profile's socd setting, which the hotkeys can change at any time.
+// Last input resolution reads the press order, so it depends on earlier frames.
+struct Socd {
+    static constexpr PipelineStageKind kind = PIPELINE_VIRTUAL;
+
+    struct State {};
+
+    static void run(State &, PipelineFrame &frame) {
+        frame.buttons = resolve_socd(frame.buttons, frame.profile->socd);
+    }
+};
+
+// Keyboard or gamepad report of the current mode, with the profile's keymap
+struct ReportEncoder {
+    static constexpr PipelineStageKind kind = PIPELINE_ENCODER;
+
+    struct State {};
+
+    static void run(State &, PipelineFrame &frame) {
+        encode_inputs(frame.buttons, frame.profile->keymap);
+    }
+};
@@ -0,0 +1,116 @@
+#include <hardware/adc.h>
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+#include <hardware/sync.h>
+
+#include "../settings.h"
+#include "../analog.h"
+#include "analog_input.h"
+
+#if ANALOG_PINS
+
+// Adc inputs 0-2 are gpio 26-28
+#define _FIRST_ADC_PIN 26
+#define _INPUT_MASK ((ANALOG_PINS >> _FIRST_ADC_PIN) & 0x7u)
+#define _INPUT_COUNT (((_INPUT_MASK >> 0) & 1) + ((_INPUT_MASK >> 1) & 1) + ((_INPUT_MASK >> 2) & 1))
+#define _BURST_LEN (_INPUT_COUNT * ANALOG_SAMPLES)
+
+_Static_assert((ANALOG_PINS & ~(0x7u << _FIRST_ADC_PIN)) == 0, "Only gpio 26-28 can be analog");
+
+// Two bursts, dma fills one while the scan reads the other. The round robin starts at the lowest input for every
+// burst, so reading i of a burst is always from input i % _INPUT_COUNT.
+static u16 _samples[2][_BURST_LEN];
+static volatile u8 _writing = 0;
+static volatile bool _has_burst = false;
+static int _dma = -1;
+
+static AnalogChannel _channels[3];
+static bool _calibrated = false;
+
+static void _dma_irq(void) {
+    dma_hw->ints0 = 1u << _dma;
+
+    // Restarting only takes a few cycles, the 4 deep adc fifo holds the readings that come in meanwhile
+    _writing ^= 1;
+    _has_burst = true;
+    dma_channel_set_write_addr(_dma, _samples[_writing], true);
+}
+
+static void _start(void) {
+    adc_run(false);
+
+    // Aborting can raise the completion interrupt, which would restart the channel
+    dma_channel_set_irq0_enabled(_dma, false);
+    dma_channel_abort(_dma);
+    dma_hw->ints0 = 1u << _dma;
+    dma_channel_set_irq0_enabled(_dma, true);
+
+    adc_fifo_drain();
+    adc_hw->fcs |= ADC_FCS_OVER_BITS;
+
+    adc_select_input(__builtin_ctz(_INPUT_MASK));
+    dma_channel_set_write_addr(_dma, _samples[_writing], true);
+    adc_run(true);
+}
+
+void analog_input_init(void) {
+    for (u32 pins = ANALOG_PINS; pins; pins &= pins - 1) adc_gpio_init(__builtin_ctz(pins));
+
+    adc_init();
+    adc_set_round_robin(_INPUT_MASK);
+    adc_fifo_setup(true, true, 1, false, false);
+    // Back to back conversions, 500k readings per second
+    adc_set_clkdiv(0);
+
+    _dma = dma_claim_unused_channel(true);
+    dma_channel_config config = dma_channel_get_default_config(_dma);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_dreq(&config, DREQ_ADC);
+    dma_channel_configure(_dma, &config, _samples[0], &adc_hw->fifo, _BURST_LEN, false);
+
+    dma_channel_set_irq0_enabled(_dma, true);
+    irq_set_exclusive_handler(DMA_IRQ_0, _dma_irq);
+    irq_set_enabled(DMA_IRQ_0, true);
+
+    _start();
+}
+
+u32 analog_input_scan(void) {
+    // A lost reading shifts the round robin out of step with the buffer, start over
+    if (adc_hw->fcs & ADC_FCS_OVER_BITS) {
+        _has_burst = false;
+        _start();
+    }
+
+    if (!_has_burst) return 0;
+
+    // Keep the interrupt from handing this burst back to the dma while it's summed, it only takes a few
+    // microseconds which the adc fifo covers
+    u32 sums[3] = {0};
+    u32 irq = save_and_disable_interrupts();
+    const u16 *burst = _samples[_writing ^ 1];
+    for (u32 i = 0; i < _BURST_LEN; ++i) sums[i % _INPUT_COUNT] += burst[i];
+    restore_interrupts(irq);
+
+    u32 pressed = 0;
+    u32 index = 0;
+    for (u32 inputs = _INPUT_MASK; inputs; inputs &= inputs - 1, ++index) {
+        int input = __builtin_ctz(inputs);
+        u16 raw = sums[index] / ANALOG_SAMPLES;
+
+        // Keys are assumed to be at rest on the first burst after boot
+        if (!_calibrated) {
+            AnalogConfig config = {ANALOG_ACTUATION, ANALOG_HYSTERESIS, ANALOG_RAPID_PRESS, ANALOG_RAPID_RELEASE};
+            analog_init(&_channels[input], &config, raw, ANALOG_RANGE);
+        }
+
+        if (analog_update(&_channels[input], raw)) pressed |= 1u << (_FIRST_ADC_PIN + input);
+    }
+
+    _calibrated = true;
+    return pressed;
+}
+
+#endif
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "../common.h"
+
+// Free running adc over the ANALOG_PINS, copied out by dma in bursts of ANALOG_SAMPLES readings per pin.
+// Only built when ANALOG_PINS is not 0.
+void analog_input_init(void);
+
+// Runs the newest complete burst through the analog decision logic and returns the pressed pins as a gpio mask
+u32 analog_input_scan(void);
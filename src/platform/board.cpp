@@ -0,0 +1,26 @@
+#include "board.h"
+#include "boards/cheatbox.hpp"
+
+static_assert(board_descriptor.count() == BUTTON_COUNT, "Every button of the board needs a gpio");
+
+struct _GpioButtons {
+    u8 button[32];
+};
+
+static constexpr _GpioButtons _gpio_buttons() {
+    _GpioButtons result = {};
+    for (u8 gpio = 0; gpio < 32; ++gpio) result.button[gpio] = board_descriptor.button_of_gpio(gpio);
+    return result;
+}
+
+static constexpr _GpioButtons _buttons = _gpio_buttons();
+
+extern "C" const u32 board_gpio_mask = board_descriptor.gpio_mask();
+
+u32 board_remap(u32 gpio) {
+    return board_remap_runs<board_descriptor>(gpio);
+}
+
+u8 board_button_of_gpio(u8 gpio) {
+    return _buttons.button[gpio & 31];
+}
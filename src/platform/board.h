@@ -0,0 +1,27 @@
+#pragma once
+
+// The board's own buttons are inputs 0 to BUTTON_COUNT - 1 in the logical order of its descriptor, whatever gpio
+// they are wired to. Expansion sources still start at input 32. Moving to another pcb takes a new descriptor and
+// button list in boards/.
+
+#include "../common.h"
+#include "boards/cheatbox.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOARD_NO_BUTTON 0xFF
+
+// Gpio that have a button
+extern const u32 board_gpio_mask;
+
+// Moves a gpio sample (bit n is gpio n) into button order (bit n is button n)
+u32 board_remap(u32 gpio);
+
+// Button wired to gpio, BOARD_NO_BUTTON if none
+u8 board_button_of_gpio(u8 gpio);
+
+#ifdef __cplusplus
+}
+#endif
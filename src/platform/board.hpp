@@ -0,0 +1,93 @@
+#pragma once
+
+// Compile time description of how a board's buttons are wired. Buttons are declared in logical order, which is the
+// input numbering everything above the platform uses, with the gpio each one is soldered to:
+//
+//     static constexpr BoardDescriptor board_descriptor = BoardDescriptor()
+//         .button(BUTTON_PINKY, 0)
+//         .button(BUTTON_RING, 1);
+//
+// The compiler turns it into the mask of gpio to configure and a remap from a gpio sample into button order.
+// Buttons that sit on consecutive gpio in the same order form a run that is moved with a single shift, so the remap
+// is a handful of and/shift/or steps without branches or a per pin loop.
+
+#include "board.h"
+
+// Deliberately not constexpr, see profile_builder.hpp
+inline void board_error_button_out_of_order() {}
+inline void board_error_gpio_out_of_range() {}
+inline void board_error_gpio_used_twice() {}
+
+// Gpio bits of a run and how far right they move to land on their buttons, negative moves left
+struct BoardRun {
+    u32 mask = 0;
+    i8 shift = 0;
+};
+
+class BoardDescriptor {
+public:
+    constexpr BoardDescriptor button(int button, u8 gpio) const {
+        BoardDescriptor result = *this;
+
+        if (button != _count) board_error_button_out_of_order();
+        if (gpio >= 30) board_error_gpio_out_of_range();
+        if (_gpio_mask & (1u << gpio)) board_error_gpio_used_twice();
+
+        result._gpio[result._count++] = gpio;
+        result._gpio_mask |= 1u << gpio;
+        return result;
+    }
+
+    constexpr u8 count() const { return _count; }
+    constexpr u32 gpio_mask() const { return _gpio_mask; }
+    constexpr u8 gpio(int button) const { return _gpio[button]; }
+
+    constexpr u8 button_of_gpio(u8 gpio) const {
+        for (u8 i = 0; i < _count; ++i) {
+            if (_gpio[i] == gpio) return i;
+        }
+        return BOARD_NO_BUTTON;
+    }
+
+    constexpr u8 run_count() const {
+        u8 runs = 0;
+        for (u8 i = 0; i < _count; ++i) {
+            if (i == 0 || _gpio[i] != _gpio[i - 1] + 1) runs += 1;
+        }
+        return runs;
+    }
+
+    constexpr BoardRun run(u8 index) const {
+        BoardRun result;
+        u8 runs = 0;
+
+        for (u8 i = 0; i < _count; ++i) {
+            if (i == 0 || _gpio[i] != _gpio[i - 1] + 1) runs += 1;
+            if (runs - 1 != index) continue;
+
+            if (result.mask == 0) result.shift = (i8) (_gpio[i] - i);
+            result.mask |= 1u << _gpio[i];
+        }
+
+        return result;
+    }
+
+private:
+    u8 _gpio[32] = {};
+    u8 _count = 0;
+    u32 _gpio_mask = 0;
+};
+
+// Moves each run of board into place, unrolled at compile time
+template<const BoardDescriptor &board, u8 run = 0>
+inline u32 board_remap_runs(u32 gpio) {
+    if constexpr (run == board.run_count()) {
+        return 0;
+    }
+    else {
+        constexpr BoardRun r = board.run(run);
+        u32 bits = gpio & r.mask;
+        u32 moved = r.shift >= 0 ? bits >> r.shift : bits << -r.shift;
+        return moved | board_remap_runs<board, run + 1>(gpio);
+    }
+}
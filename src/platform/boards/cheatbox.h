@@ -0,0 +1,44 @@
+#pragma once
+
+// Buttons of the cheatbox pcb in logical order, named by where they sit. The gpio of each is in cheatbox.hpp.
+//
+//                       MOD
+//                  F1   F2   F3   F4
+//                  F5   F6   F7   F8
+//                       HOME
+//  PINKY RING MIDDLE INDEX      TOP_1    TOP_2    TOP_3    TOP_4
+//                               BOTTOM_1 BOTTOM_2 BOTTOM_3 BOTTOM_4
+//      LEFT_THUMB_1 LEFT_THUMB_2    RIGHT_THUMB_1 RIGHT_THUMB_2
+typedef enum {
+    BUTTON_PINKY,
+    BUTTON_RING,
+    BUTTON_MIDDLE,
+    BUTTON_INDEX,
+
+    BUTTON_TOP_1,
+    BUTTON_TOP_2,
+    BUTTON_TOP_3,
+    BUTTON_TOP_4,
+    BUTTON_BOTTOM_1,
+    BUTTON_BOTTOM_2,
+    BUTTON_BOTTOM_3,
+    BUTTON_BOTTOM_4,
+
+    BUTTON_LEFT_THUMB_1,
+    BUTTON_LEFT_THUMB_2,
+    BUTTON_RIGHT_THUMB_1,
+    BUTTON_RIGHT_THUMB_2,
+
+    BUTTON_MOD,
+    BUTTON_F1,
+    BUTTON_F2,
+    BUTTON_F3,
+    BUTTON_F4,
+    BUTTON_F5,
+    BUTTON_F6,
+    BUTTON_F7,
+    BUTTON_F8,
+    BUTTON_HOME,
+
+    BUTTON_COUNT,
+} ButtonName;
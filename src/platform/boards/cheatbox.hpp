@@ -0,0 +1,36 @@
+#pragma once
+
+#include "../board.hpp"
+#include "cheatbox.h"
+
+// The rp2040 pins each button is soldered to. gpio 23-25 aren't broken out on the pico.
+static constexpr BoardDescriptor board_descriptor = BoardDescriptor()
+    .button(BUTTON_PINKY, 0)
+    .button(BUTTON_RING, 1)
+    .button(BUTTON_MIDDLE, 2)
+    .button(BUTTON_INDEX, 3)
+
+    .button(BUTTON_TOP_1, 4)
+    .button(BUTTON_TOP_2, 5)
+    .button(BUTTON_TOP_3, 6)
+    .button(BUTTON_TOP_4, 7)
+    .button(BUTTON_BOTTOM_1, 8)
+    .button(BUTTON_BOTTOM_2, 9)
+    .button(BUTTON_BOTTOM_3, 10)
+    .button(BUTTON_BOTTOM_4, 11)
+
+    .button(BUTTON_LEFT_THUMB_1, 12)
+    .button(BUTTON_LEFT_THUMB_2, 13)
+    .button(BUTTON_RIGHT_THUMB_1, 14)
+    .button(BUTTON_RIGHT_THUMB_2, 15)
+
+    .button(BUTTON_MOD, 16)
+    .button(BUTTON_F1, 17)
+    .button(BUTTON_F2, 18)
+    .button(BUTTON_F3, 19)
+    .button(BUTTON_F4, 20)
+    .button(BUTTON_F5, 21)
+    .button(BUTTON_F6, 22)
+    .button(BUTTON_F7, 26)
+    .button(BUTTON_F8, 27)
+    .button(BUTTON_HOME, 28);
@@ -0,0 +1,567 @@
+#include "../settings.h"
+#include "../temporal.h"
+#include "../stats.h"
+#include "device.h"
+#include "postmortem.h"
+#include "report_ids.h"
+
+// Vendor field appended to the input reports so a host capture can be linked back to the scan that produced it
+typedef struct __attribute__((packed)) {
+    // Increments with every input report, a gap on the host means a report was lost
+    u16 sequence;
+    // Low bits of the scan number that produced the report
+    u16 frame;
+    // Microseconds from the newest physical edge of that scan to the report being queued, REPORT_TIMING_NO_EDGE if none
+    u16 edge_to_report_us;
+    // When the last host output report arrived, counted from the scan before it, and how long it took to answer
+    u16 probe_phase_us;
+    u16 probe_to_report_us;
+    // Probe token of that output report, only set in the first input report after it
+    u8 probe_echo;
+} _ReportTiming;
+
+// Tiny usb handles the report ID so i dont need to include it in the packet.
+typedef struct __attribute__((packed)) {
+  u8 modifier;
+  u8 keycode[12];
+#if REPORT_TIMING
+  _ReportTiming timing;
+#endif
+} _NKROKeyboardReport;
+
+typedef struct __attribute__((packed)) {
+    i8 lx;
+    i8 ly; // left stick
+
+    i8 rx;
+    i8 ry; // right stick
+
+    i8 lt;
+    i8 rt; // left/right trigger
+    
+    u8 dpad;
+
+    u32 buttons;
+#if REPORT_TIMING
+    _ReportTiming timing;
+#endif
+} _GamepadReport;
+
+typedef struct {
+    InputMode mode;
+    // Report interval in milliseconds
+    u8 polling_ms;
+
+    // true if there is keyboard input to report
+    bool has_keyboard_input;
+
+    // true if there is gamepad input to report
+    bool has_gamepad_input;
+    
+    // States of the physical buttons, after the input filter
+    InputMask b_new;
+    InputMask b_old;
+    InputFilter filter;
+
+    bool board_button_new;
+    bool board_button_old;
+
+    // Time and number of the current scan
+    u32 scan_us;
+    u32 frame;
+
+    // Time of the newest edge in the current scan
+    bool has_edge;
+    u32 edge_us;
+    u16 report_sequence;
+
+    // Output report that hasn't been answered yet
+    bool probe_pending;
+    u8 probe_token;
+    u32 probe_us;
+    u16 probe_phase_us;
+
+    bool clean_report;
+    // The previous report of the current mode had input, so a release needs an empty report
+    bool had_input;
+
+    // Set when anything the user callback reads changed since it last ran
+    bool dirty;
+    // Report repeated on frames that are not evaluated, 0 if nothing is sent
+    u8 repeat_report;
+    FrameStats frame_stats;
+
+    // Stress pattern frames left and reports sent in it, see platform_stress
+    u32 stress_frames;
+    u32 stress_sent;
+
+    // USB report structs
+    _NKROKeyboardReport keyboard;
+    _GamepadReport gamepad;
+} _DeviceState;
+
+// The first frame always runs the user callback
+static _DeviceState _device = {.polling_ms = POLLING_RATE, .dirty = true};
+
+// Microseconds since boot at which each boot phase completed
+static u32 _boot_us[BOOT_PHASE_COUNT] = {0};
+
+void device_mark_boot_phase(BootPhase phase, u32 now_us) {
+    if (_boot_us[phase] == 0) _boot_us[phase] = now_us;
+}
+
+u32 platform_boot_time_us(BootPhase phase) {
+    if (phase >= BOOT_PHASE_COUNT) return 0;
+    return _boot_us[phase];
+}
+
+u16 platform_read_boot_times(u8 *buffer, u16 len) {
+    u16 size = sizeof(_boot_us);
+    if (len < size) return 0;
+
+    memcpy(buffer, _boot_us, size);
+    return size;
+}
+
+void platform_set_mode(InputMode mode) {
+    _device.clean_report = true;
+    _device.had_input = false;
+    _device.mode = mode;
+    _device.dirty = true;
+}
+
+void platform_set_polling(u8 ms) {
+    if (ms != 1 && ms != 2 && ms != 4 && ms != 8) return;
+    if (ms == _device.polling_ms) return;
+
+    _device.polling_ms = ms;
+    backend_set_polling(ms);
+}
+
+u8 platform_get_polling(void) {
+    return _device.polling_ms;
+}
+
+void platform_set_input_filter(InputFilter filter) {
+    _device.filter = filter;
+}
+
+void platform_request_update(void) {
+    _device.dirty = true;
+}
+
+u32 platform_report_tick(void) {
+    return _device.frame_stats.frames;
+}
+
+FrameStats platform_frame_stats(void) {
+    return _device.frame_stats;
+}
+
+u16 platform_read_frame_stats(u8 *buffer, u16 len) {
+    u16 size = sizeof(_device.frame_stats);
+    if (len < size) return 0;
+
+    memcpy(buffer, &_device.frame_stats, size);
+    return size;
+}
+
+bool platform_stress(u32 frames) {
+    // The keyboard pattern is numbered by the timing field alone, without it there is nothing to number it by
+    if (frames && _device.mode == MODE_KEYBOARD && !REPORT_TIMING) return false;
+
+    _device.stress_frames = frames;
+    _device.stress_sent = 0;
+    _device.dirty = true;
+    return true;
+}
+
+u16 platform_read_stress(u8 *buffer, u16 len) {
+    u32 data[2] = { _device.stress_frames, _device.stress_sent };
+    if (len < sizeof(data)) return 0;
+
+    memcpy(buffer, data, sizeof(data));
+    return sizeof(data);
+}
+
+InputMode platform_get_mode(void) {
+    return _device.mode;
+}
+
+void device_scan(InputMask buttons, bool board_button, u32 scan_us, const u32 *edge_us) {
+    _device.b_old = _device.b_new;
+    _device.b_new = _device.filter ? _device.filter(buttons, scan_us) : buttons;
+    _device.board_button_old = _device.board_button_new;
+    _device.board_button_new = board_button;
+    _device.scan_us = scan_us;
+    _device.frame += 1;
+
+    _device.has_edge = false;
+    for (InputMask changed = _device.b_new ^ _device.b_old; changed; changed &= changed - 1) {
+        u32 at = edge_us[__builtin_ctzll(changed)];
+        if (!_device.has_edge || (i32)(at - _device.edge_us) > 0) _device.edge_us = at;
+        _device.has_edge = true;
+    }
+
+    // Accumulates until the next evaluated frame so scans where usb wasn't ready aren't lost
+    if (_device.b_new != _device.b_old || _device.board_button_new != _device.board_button_old) _device.dirty = true;
+
+    if (_device.b_new != _device.b_old) postmortem_inputs(_device.frame, _device.b_new);
+
+    // Only presses, the hotkey that started it is still being let go
+    if (_device.stress_frames && (_device.b_new & ~_device.b_old)) platform_stress(0);
+
+    temporal_pin_edges(_device.b_new, _device.b_old, edge_us);
+    stats_update(_device.b_new, _device.b_old);
+}
+
+#if REPORT_TIMING
+static void _stamp(_ReportTiming *timing) {
+    timing->sequence = _device.report_sequence++;
+    timing->frame = (u16) _device.frame;
+
+    u32 elapsed = backend_time_us() - _device.edge_us;
+    if (!_device.has_edge)                     timing->edge_to_report_us = REPORT_TIMING_NO_EDGE;
+    else if (elapsed >= REPORT_TIMING_NO_EDGE) timing->edge_to_report_us = REPORT_TIMING_NO_EDGE - 1;
+    else                                       timing->edge_to_report_us = (u16) elapsed;
+
+    timing->probe_echo = 0;
+    timing->probe_phase_us = REPORT_TIMING_NO_EDGE;
+    timing->probe_to_report_us = REPORT_TIMING_NO_EDGE;
+
+    if (_device.probe_pending) {
+        u32 answer = backend_time_us() - _device.probe_us;
+
+        _device.probe_pending = false;
+        timing->probe_echo = _device.probe_token;
+        timing->probe_phase_us = _device.probe_phase_us;
+        timing->probe_to_report_us = answer >= REPORT_TIMING_NO_EDGE ? REPORT_TIMING_NO_EDGE - 1 : (u16) answer;
+    }
+}
+#endif
+
+void device_keyboard_output(const u8 *report, u16 len, u32 now_us) {
+#if REPORT_TIMING
+    // The leds come first, the os writes them with a token of 0 which isn't a probe
+    if (len < 2 || report[1] == 0) return;
+
+    u32 phase = now_us - _device.scan_us;
+    _device.probe_pending = true;
+    _device.probe_token = report[1];
+    _device.probe_us = now_us;
+    _device.probe_phase_us = phase >= REPORT_TIMING_NO_EDGE ? REPORT_TIMING_NO_EDGE - 1 : (u16) phase;
+#else
+    (void) report;
+    (void) len;
+    (void) now_us;
+#endif
+}
+
+static void _send_keyboard_report(void) {
+#if REPORT_TIMING
+    _stamp(&_device.keyboard.timing);
+#endif
+    backend_send_report(REPORT_ID_KEYBOARD, &_device.keyboard, sizeof(_device.keyboard));
+}
+
+static void _send_gamepad_report(void) {
+#if REPORT_TIMING
+    _stamp(&_device.gamepad.timing);
+#endif
+    backend_send_report(REPORT_ID_GAMEPAD, &_device.gamepad, sizeof(_device.gamepad));
+}
+
+static void _send_keyboard_input(void) {
+    if (_device.clean_report) {
+        // Send last clean gamepad report when changing modes
+        _device.clean_report = false;
+        _device.dirty = true;
+        memset(&_device.gamepad, 0, sizeof(_device.gamepad));
+        _send_gamepad_report();
+        return;
+    }
+
+    if (_device.has_keyboard_input) {
+        _device.had_input = true;
+        _device.repeat_report = REPORT_ID_KEYBOARD;
+        _send_keyboard_report();
+    }
+    else {
+        if (_device.had_input) {
+            // Send empty report
+            memset(&_device.keyboard, 0, sizeof(_device.keyboard));
+            _send_keyboard_report();
+        }
+
+        _device.had_input = false;
+    }
+}
+
+static void _send_gamepad_input(void) {
+    if (_device.clean_report) {
+        // Send a last clean keyboard report when changing modes
+        _device.clean_report = false;
+        _device.dirty = true;
+        memset(&_device.keyboard, 0, sizeof(_device.keyboard));
+        _send_keyboard_report();
+        return;
+    }
+
+    if (_device.has_gamepad_input) {
+        _device.had_input = true;
+        _device.repeat_report = REPORT_ID_GAMEPAD;
+        _send_gamepad_report();
+    }
+    else {
+        if (_device.had_input) {
+            // Send empty report
+            memset(&_device.gamepad, 0, sizeof(_device.gamepad));
+            _send_gamepad_report();
+        }
+
+        _device.had_input = false;
+    }
+}
+
+static void _repeat_report(void) {
+    switch (_device.repeat_report) {
+        case REPORT_ID_KEYBOARD: _send_keyboard_report(); break;
+        case REPORT_ID_GAMEPAD:  _send_gamepad_report();  break;
+    }
+}
+
+// A probe is answered on the frame after it arrived even if there was nothing else to send
+static void _answer_probe(void) {
+    if (!_device.probe_pending) return;
+
+    switch (_device.mode) {
+        case MODE_KEYBOARD: _send_keyboard_report(); break;
+        case MODE_GAMEPAD:  _send_gamepad_report();  break;
+    }
+}
+
+static void _write_u32(u8 *data, u32 value) {
+    for (int i = 0; i < 4; ++i) data[i] = (u8) (value >> (8 * i));
+}
+
+static void _stress_frame(void) {
+    u32 n = _device.stress_sent++;
+    _device.stress_frames -= 1;
+
+    // The next normal frame clears whatever the pattern left pressed
+    _device.had_input = true;
+    _device.dirty = true;
+
+    switch (_device.mode) {
+        case MODE_KEYBOARD: {
+            // No keys, so nothing is typed on the host. The report sequence is the report number.
+            memset(&_device.keyboard, 0, sizeof(_device.keyboard));
+#if REPORT_TIMING
+            _device.report_sequence = (u16) n;
+#endif
+            _send_keyboard_report();
+        } break;
+
+        case MODE_GAMEPAD: {
+            memset(&_device.gamepad, 0, sizeof(_device.gamepad));
+
+            u8 axes[4];
+            _write_u32(axes, n);
+            _device.gamepad.lx = (i8) axes[0];
+            _device.gamepad.ly = (i8) axes[1];
+            _device.gamepad.rx = (i8) axes[2];
+            _device.gamepad.ry = (i8) axes[3];
+            _device.gamepad.buttons = 1u << (n % 32);
+            _send_gamepad_report();
+        } break;
+    }
+}
+
+void device_frame(TaskCallback callback) {
+    _device.frame_stats.frames += 1;
+
+    // Replaces the profile entirely, the report also answers any probe
+    if (_device.stress_frames) {
+        _stress_frame();
+        return;
+    }
+
+    // Nothing the callback depends on changed, so it would build the same report again
+    if (!_device.dirty) {
+        _device.frame_stats.skipped += 1;
+        _repeat_report();
+        _answer_probe();
+        return;
+    }
+
+    u32 start_us = backend_time_us();
+
+    // Cleared before the callback so it can request the next frame
+    _device.dirty = false;
+    _device.repeat_report = 0;
+    _device.has_keyboard_input = false;
+    _device.has_gamepad_input = false;
+    memset(&_device.keyboard, 0, sizeof(_device.keyboard));
+    memset(&_device.gamepad, 0, sizeof(_device.gamepad));
+
+    // Callback to user input handling code
+    callback();
+
+    switch (_device.mode) {
+        case MODE_KEYBOARD: _send_keyboard_input(); break;
+        case MODE_GAMEPAD:  _send_gamepad_input();  break;
+    }
+
+    _answer_probe();
+
+    _device.frame_stats.evaluated += 1;
+    _device.frame_stats.eval_us += backend_time_us() - start_us;
+}
+
+u32 platform_time_us(void) {
+    return _device.scan_us;
+}
+
+u32 platform_frame(void) {
+    return _device.frame;
+}
+
+bool has_input(void) {
+    return _device.b_new || _device.b_old;
+}
+
+InputMask button_mask(void) {
+    return _device.b_new;
+}
+
+bool button_down(int index) {
+    if (index < 0 || index >= INPUT_COUNT) return false;
+    return !!(_device.b_new & INPUT_BIT(index));
+}
+
+bool button_up(int index) {
+    if (index < 0 || index >= INPUT_COUNT) return false;
+    return !(_device.b_new & INPUT_BIT(index));
+}
+
+bool button_pressed(int index) {
+    if (index < 0 || index >= INPUT_COUNT) return false;
+    return (_device.b_new & INPUT_BIT(index)) && !(_device.b_old & INPUT_BIT(index));
+}
+
+bool button_released(int index) {
+    if (index < 0 || index >= INPUT_COUNT) return false;
+    return !(_device.b_new & INPUT_BIT(index)) && (_device.b_old & INPUT_BIT(index));
+}
+
+bool board_button_down(void) {
+    return _device.board_button_new;
+}
+
+bool board_button_up(void) {
+    return !_device.board_button_new;
+}
+
+bool board_button_pressed(void) {
+    return _device.board_button_new && !_device.board_button_old;
+}
+
+bool board_button_released(void) {
+    return !_device.board_button_new && _device.board_button_old;
+}
+
+void keyboard_press(KeyCode key) {
+    if (
+        key > KEY_GUI_RIGHT ||
+        key < KEY_A ||
+        (key > KEY_KEYPAD_DECIMAL && key < KEY_CONTROL_LEFT)
+    ) return;
+
+    _device.has_keyboard_input = true;
+
+    if (key > KEY_KEYPAD_DECIMAL) {
+        _device.keyboard.modifier |= 1 << (key - KEY_CONTROL_LEFT);
+    }
+    else {
+        _device.keyboard.keycode[((key - KEY_A) / 8)] |= 1 << ((key - KEY_A) % 8);
+    }
+}
+
+void keyboard_release(KeyCode key) {
+    if (
+        key > KEY_GUI_RIGHT ||
+        key < KEY_A ||
+        (key > KEY_KEYPAD_DECIMAL && key < KEY_CONTROL_LEFT)
+    ) return;
+
+    _device.has_keyboard_input = true;
+
+    if (key > KEY_KEYPAD_DECIMAL) {
+        _device.keyboard.modifier &= ~(1 << (key - KEY_CONTROL_LEFT));
+    }
+    else {
+        _device.keyboard.keycode[((key - KEY_A) / 8)] &= ~(1 << ((key - KEY_A) % 8));
+    }
+}
+
+void keyboard_release_all(void) {
+    _device.has_keyboard_input = true;
+    memset(&_device.keyboard, 0, sizeof(_device.keyboard));
+}
+
+void gamepad_left_stick(i8 x, i8 y) {
+    _device.has_gamepad_input = true;
+    _device.gamepad.lx = x;
+    _device.gamepad.ly = y;
+}
+
+void gamepad_left_stick_x(i8 x) {
+    _device.has_gamepad_input = true;
+    _device.gamepad.lx = x;
+}
+
+void gamepad_left_stick_y(i8 y) {
+    _device.has_gamepad_input = true;
+    _device.gamepad.ly = y;
+}
+
+void gamepad_right_stick(i8 x, i8 y) {
+    _device.has_gamepad_input = true;
+    _device.gamepad.rx = x;
+    _device.gamepad.ry = y;
+}
+
+void gamepad_right_stick_x(i8 x) {
+    _device.has_gamepad_input = true;
+    _device.gamepad.rx = x;
+}
+
+void gamepad_right_stick_y(i8 y) {
+    _device.has_gamepad_input = true;
+    _device.gamepad.ry = y;
+}
+
+void gamepad_left_trigger(i8 strength) {
+    _device.has_gamepad_input = true;
+    _device.gamepad.rx = strength;
+}
+
+void gamepad_right_trigger(i8 strength) {
+    _device.has_gamepad_input = true;
+    _device.gamepad.ry = strength;
+}
+
+void gamepad_dpad(DPadDirection direction) {
+    _device.has_gamepad_input = true;
+    _device.gamepad.dpad = direction;
+}
+
+void gamepad_button_press(u32 button) {
+    _device.has_gamepad_input = true;
+    _device.gamepad.buttons |= button;
+}
+
+void gamepad_button_release(u32 button) {
+    _device.has_gamepad_input = true;
+    _device.gamepad.buttons &= ~button;
+}
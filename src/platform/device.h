@@ -0,0 +1,31 @@
+#pragma once
+
+// Input state and report encoding shared by every platform backend.
+// Backends own the timer, the input hardware and the hid transport and drive this module once per scan.
+
+#include "../common.h"
+#include "platform.h"
+
+// Implemented by each backend. Queues a hid input report, the report id is not part of report.
+void backend_send_report(u8 report_id, const void *report, u16 len);
+// Implemented by each backend. Current time on the same clock as the scan and edge times.
+u32 backend_time_us(void);
+// Implemented by each backend. Free running cpu cycle counter, only the low 24 bits (the width of the cortex-m0+
+// systick) count so differences have to be masked with BACKEND_CYCLES_MASK.
+#define BACKEND_CYCLES_MASK 0xFFFFFFu
+u32 backend_cycles(void);
+// Implemented by each backend. Moves the scan and the hid endpoint to a new report interval, see platform_set_polling.
+void backend_set_polling(u8 ms);
+
+// Latches a new physical sample. edge_us holds INPUT_COUNT times, the first edge of every input that changed.
+void device_scan(InputMask buttons, bool board_button, u32 scan_us, const u32 *edge_us);
+
+// Called by the backend with the keyboard output report, without the report id.
+// With REPORT_TIMING a non zero probe token after the leds is echoed in the next input report.
+void device_keyboard_output(const u8 *report, u16 len, u32 now_us);
+
+// Runs the user callback and sends the resulting report
+void device_frame(TaskCallback callback);
+
+// Records the first time a boot phase completed
+void device_mark_boot_phase(BootPhase phase, u32 now_us);
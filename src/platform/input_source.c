@@ -0,0 +1,63 @@
+#include "input_source.h"
+#include "device.h"
+
+static const InputSource *_sources = NULL;
+static u8 _count = 0;
+
+static InputMask _last = 0;
+static InputSourceStats _stats[INPUT_SOURCE_MAX] = {0};
+
+void input_sources_init(const InputSource *sources, u8 count) {
+    if (count > INPUT_SOURCE_MAX) count = INPUT_SOURCE_MAX;
+
+    _sources = sources;
+    _count = count;
+}
+
+InputMask input_sources_read(u32 scan_us, InputMask stamped, u32 *edge_us) {
+    InputMask state = 0;
+
+    for (u8 i = 0; i < _count; ++i) {
+        const InputSource *source = &_sources[i];
+        InputSourceStats *stats = &_stats[i];
+
+        u32 start_us = backend_time_us();
+        u32 sample_us = scan_us;
+        u32 bits = source->read(&sample_us);
+        u32 read_us = backend_time_us() - start_us;
+
+        u32 valid = source->count < 32 ? (1u << source->count) - 1 : 0xFFFFFFFFu;
+        InputMask range = (InputMask) valid << source->first;
+        InputMask mask = (InputMask) (bits & valid) << source->first;
+        state |= mask;
+
+        // Changes the source saw without an edge time of their own happened at the latest when it was sampled
+        for (InputMask changed = (mask ^ (_last & range)) & ~stamped; changed; changed &= changed - 1) {
+            edge_us[__builtin_ctzll(changed)] = sample_us;
+        }
+
+        u32 age_us = (i32)(scan_us - sample_us) > 0 ? scan_us - sample_us : 0;
+        stats->last_age_us = age_us;
+        if (age_us > stats->max_age_us) stats->max_age_us = age_us;
+        if (read_us > stats->max_read_us) stats->max_read_us = read_us;
+    }
+
+    _last = state;
+    return state;
+}
+
+void input_sources_start(void) {
+    for (u8 i = 0; i < _count; ++i) {
+        if (_sources[i].start) _sources[i].start();
+    }
+}
+
+u16 input_sources_read_stats(u8 *buffer, u16 len) {
+    u8 count = _count;
+    if (len < 1) return 0;
+    if (count > (len - 1) / sizeof(InputSourceStats)) count = (len - 1) / sizeof(InputSourceStats);
+
+    buffer[0] = count;
+    memcpy(buffer + 1, _stats, count * sizeof(InputSourceStats));
+    return 1 + count * sizeof(InputSourceStats);
+}
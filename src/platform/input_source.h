@@ -0,0 +1,41 @@
+#pragma once
+
+// Physical inputs come from a list of sources that are merged into one wide InputMask every scan.
+// Each source covers up to 32 consecutive inputs and sources must not overlap.
+
+#include "../common.h"
+#include "platform.h"
+
+#define INPUT_SOURCE_MAX 8
+
+typedef struct {
+    // Returns the newest sample, bit 0 is input `first`. Sets sample_us to when the sample was taken, which is
+    // earlier than the scan for sources that are read in the background.
+    u32 (*read)(u32 *sample_us);
+    // Optional. Called right after every scan to start a background read that overlaps with the rest of the frame.
+    void (*start)(void);
+    u8 first;
+    u8 count;
+} InputSource;
+
+// How much each source adds to the input latency
+typedef struct {
+    // Scan time minus the sample time of the last and the worst read
+    u32 last_age_us;
+    u32 max_age_us;
+    // Longest time spent inside read, which delays every source after it
+    u32 max_read_us;
+} InputSourceStats;
+
+// sources must outlive the module
+void input_sources_init(const InputSource *sources, u8 count);
+
+// Reads every source in order and returns the merged state. Inputs that changed since the previous call and are
+// not in stamped get their source's sample time written to edge_us.
+InputMask input_sources_read(u32 scan_us, InputMask stamped, u32 *edge_us);
+
+// Starts the background reads for the next scan
+void input_sources_start(void);
+
+// Writes [count, InputSourceStats * count]. Returns the number of bytes written.
+u16 input_sources_read_stats(u8 *buffer, u16 len);
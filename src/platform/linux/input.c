@@ -0,0 +1,195 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+
+#include "../board.h"
+#include "input.h"
+
+// How long a script keeps running after its last event so the final release reaches the host
+#define _SCRIPT_TAIL_US 100000
+
+typedef struct {
+    u64 time_us;
+    u8 pin;
+    bool down;
+} _ScriptEvent;
+
+// Inputs 0 to _INPUT_COUNT - 1, same as INPUT_COUNT in platform.h
+#define _INPUT_COUNT 64
+
+// Evdev keys standing in for the box, roughly following the layout in boards/cheatbox.h
+static const u16 _evdev_map[_INPUT_COUNT] = {
+    [BUTTON_PINKY]         = KEY_LEFTSHIFT,
+    [BUTTON_RING]          = KEY_A,
+    [BUTTON_MIDDLE]        = KEY_S,
+    [BUTTON_INDEX]         = KEY_D,
+    [BUTTON_TOP_1]         = KEY_U,
+    [BUTTON_TOP_2]         = KEY_I,
+    [BUTTON_TOP_3]         = KEY_O,
+    [BUTTON_TOP_4]         = KEY_P,
+    [BUTTON_BOTTOM_1]      = KEY_J,
+    [BUTTON_BOTTOM_2]      = KEY_K,
+    [BUTTON_BOTTOM_3]      = KEY_L,
+    [BUTTON_BOTTOM_4]      = KEY_SEMICOLON,
+    [BUTTON_LEFT_THUMB_1]  = KEY_SPACE,
+    [BUTTON_LEFT_THUMB_2]  = KEY_C,
+    [BUTTON_RIGHT_THUMB_1] = KEY_V,
+    [BUTTON_RIGHT_THUMB_2] = KEY_B,
+    [BUTTON_MOD]           = KEY_ESC,
+    [BUTTON_F1]            = KEY_F1,
+    [BUTTON_F2]            = KEY_F2,
+    [BUTTON_F3]            = KEY_F3,
+    [BUTTON_F4]            = KEY_F4,
+    [BUTTON_F5]            = KEY_F5,
+    [BUTTON_F6]            = KEY_F6,
+    [BUTTON_F7]            = KEY_F7,
+    [BUTTON_F8]            = KEY_F8,
+    [BUTTON_HOME]          = KEY_TAB,
+
+    // First inputs of the mock expander
+    [32] = KEY_KP1,
+    [33] = KEY_KP2,
+    [34] = KEY_KP3,
+    [35] = KEY_KP4,
+};
+
+static u64 _origin_us = 0;
+
+static _ScriptEvent *_script = NULL;
+static size_t _script_len = 0;
+static size_t _script_pos = 0;
+
+static int _evdev = -1;
+
+static u64 _timeval_us(struct timeval tv) {
+    return (u64) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+u64 input_clock_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static bool _load_script(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "cheatbox: can't open script %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    size_t capacity = 0;
+    char line[256];
+    int line_number = 0;
+
+    while (fgets(line, sizeof(line), file)) {
+        line_number += 1;
+
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        double time_ms;
+        int pin, down;
+        int fields = sscanf(line, "%lf %d %d", &time_ms, &pin, &down);
+        if (fields <= 0) continue;
+
+        if (fields != 3 || pin < 0 || pin >= _INPUT_COUNT || time_ms < 0) {
+            fprintf(stderr, "cheatbox: %s:%d: expected \"<time_ms> <pin> <0|1>\"\n", path, line_number);
+            fclose(file);
+            return false;
+        }
+
+        if (_script_len == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            _script = realloc(_script, capacity * sizeof(*_script));
+        }
+
+        _script[_script_len++] = (_ScriptEvent) {
+            .time_us = (u64) (time_ms * 1000.0),
+            .pin = (u8) pin,
+            .down = down != 0,
+        };
+    }
+
+    fclose(file);
+
+    if (_script_len == 0) {
+        fprintf(stderr, "cheatbox: %s has no events\n", path);
+        return false;
+    }
+
+    return true;
+}
+
+static bool _open_evdev(const char *path) {
+    _evdev = open(path, O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+    if (_evdev < 0) {
+        fprintf(stderr, "cheatbox: can't open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    // Event times on the same clock as everything else so edges can be compared with scan times
+    int clock = CLOCK_MONOTONIC;
+    ioctl(_evdev, EVIOCSCLOCKID, &clock);
+    return true;
+}
+
+bool input_init(u64 origin_us) {
+    _origin_us = origin_us;
+
+    const char *script = getenv("CHEATBOX_SCRIPT");
+    if (script) return _load_script(script);
+
+    const char *evdev = getenv("CHEATBOX_EVDEV");
+    if (evdev) return _open_evdev(evdev);
+
+    fprintf(stderr, "cheatbox: set CHEATBOX_SCRIPT or CHEATBOX_EVDEV to provide input\n");
+    return false;
+}
+
+static void _apply(u64 *buttons, u32 *edge_us, u64 *changed, int pin, bool down, u64 time_us) {
+    u64 bit = (u64) 1 << pin;
+    bool was_down = *buttons & bit;
+    if (was_down == down) return;
+
+    *buttons ^= bit;
+
+    // Only the first edge since the last poll counts, like the gpio interrupt on the pico
+    if (!(*changed & bit)) edge_us[pin] = (u32) (time_us - _origin_us);
+    *changed |= bit;
+}
+
+bool input_poll(u64 *buttons, u32 *edge_us, u64 *changed) {
+    *changed = 0;
+
+    if (_script) {
+        u64 now = input_clock_us() - _origin_us;
+
+        while (_script_pos < _script_len && _script[_script_pos].time_us <= now) {
+            _ScriptEvent *event = &_script[_script_pos++];
+            _apply(buttons, edge_us, changed, event->pin, event->down, _origin_us + event->time_us);
+        }
+
+        return _script_pos < _script_len || now < _script[_script_len - 1].time_us + _SCRIPT_TAIL_US;
+    }
+
+    if (_evdev >= 0) {
+        struct input_event event;
+        while (read(_evdev, &event, sizeof(event)) == sizeof(event)) {
+            if (event.type != EV_KEY || event.value == 2) continue;
+
+            for (int pin = 0; pin < _INPUT_COUNT; ++pin) {
+                if (_evdev_map[pin] && _evdev_map[pin] == event.code) {
+                    _apply(buttons, edge_us, changed, pin, event.value != 0, _timeval_us(event.time));
+                }
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// Physical input for the linux port, either a script or an evdev device standing in for the gpio pins.
+//
+// CHEATBOX_SCRIPT=<file>  replays "<time_ms> <pin> <0|1>" lines, '#' starts a comment
+// CHEATBOX_EVDEV=<device> reads key events from /dev/input/eventN and maps them to pins
+
+#include "../../common.h"
+
+// Monotonic clock in microseconds
+u64 input_clock_us(void);
+
+// Opens the source selected by the environment. origin_us is the clock value that maps to time 0.
+bool input_init(u64 origin_us);
+
+// Applies every event up to now. Updates the input mask (INPUT_COUNT bits) and the time of the first edge of each
+// changed input, and sets changed to the inputs that got a new edge time. Returns false once a script has played out.
+// The masks are plain u64 because this file can't include platform.h, linux/input.h defines the same KEY_ names.
+bool input_poll(u64 *buttons, u32 *edge_us, u64 *changed);
@@ -0,0 +1,306 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+#include "../../plugin.h"
+#include "../../settings.h"
+#include "../../stats.h"
+#include "../../vendor.h"
+#include "../device.h"
+#include "../input_source.h"
+#include "../postmortem.h"
+#include "../report_descriptor.h"
+#include "../report_ids.h"
+#include "../scheduler.h"
+#include "input.h"
+#include "uhid.h"
+
+// Linux userspace backend. Runs the unmodified firmware on a pc, reading input from a script or evdev and
+// presenting the same hid device as the pico through /dev/uhid.
+//
+// CHEATBOX_UHID=<path|none>  uhid node, "none" only traces reports (default /dev/uhid)
+// CHEATBOX_TRACE=1           prints every report to stdout as "<time_us> <report_id> <hex bytes>"
+// CHEATBOX_POSTMORTEM=<path> file that keeps the post-mortem log between runs, like the pico's uninitialised ram
+// See input.h for the input sources.
+
+static u64 _origin_us = 0;
+
+static bool _has_uhid = false;
+static bool _started = false;
+static bool _opened = false;
+static bool _trace = false;
+static bool _deferred_init_done = false;
+
+// Every input as the script or evdev sees it, and the ones that got an exact edge time in the last poll
+static u64 _inputs = 0;
+static u64 _stamped = 0;
+static u32 _edge_us[INPUT_COUNT] = {0};
+
+// Snapshot taken by the mock expander after each scan
+static u32 _expander_sample = 0;
+static u32 _expander_sample_us = 0;
+
+// User init that is postponed until the device is enumerated
+static TaskCallback _deferred_init = NULL;
+// User callback of the current platform_task call
+static TaskCallback _callback = NULL;
+
+// The watchdog is SIGALRM, which marks the mapped log and ends the process like a reset would
+typedef struct {
+    PostMortemLog log;
+    volatile u32 watchdog_fired;
+} _PostMortemFile;
+
+static _PostMortemFile _postmortem_memory = {0};
+static _PostMortemFile *_postmortem = &_postmortem_memory;
+
+static u32 _now_us(void) {
+    return (u32) (input_clock_us() - _origin_us);
+}
+
+static void _mark_boot_phase(BootPhase phase) {
+    device_mark_boot_phase(phase, _now_us());
+}
+
+static void _deferred_init_task(void) {
+    if (_deferred_init_done || !_started) return;
+    _deferred_init_done = true;
+
+    if (_deferred_init) _deferred_init();
+
+    _mark_boot_phase(BOOT_PHASE_DEFERRED_INIT);
+}
+
+u32 backend_time_us(void) {
+    return _now_us();
+}
+
+u32 backend_cycles(void) {
+    // Cycles of a nominal 125MHz pico, plugins never run here so nothing depends on it
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u32) (((u64) ts.tv_sec * 1000000000 + ts.tv_nsec) / 8) & BACKEND_CYCLES_MASK;
+}
+
+void backend_set_polling(u8 ms) {
+    // A uhid device has no endpoint and the kernel reads reports as they are written, so there is nothing to
+    // enumerate again and only the scan moves to the new interval
+    scheduler_set_period(0, ms * 1000);
+    if (_trace) fprintf(stderr, "polling %u ms\n", ms);
+}
+
+void backend_send_report(u8 report_id, const void *report, u16 len) {
+    if (_has_uhid) uhid_send(report_id, report, len);
+
+    if (_trace) {
+        printf("%u %u", _now_us(), report_id);
+        for (u16 i = 0; i < len; ++i) printf(" %02x", ((const u8 *) report)[i]);
+        printf("\n");
+    }
+
+    _mark_boot_phase(BOOT_PHASE_FIRST_REPORT);
+}
+
+static void _on_watchdog(int signal) {
+    (void) signal;
+    _postmortem->watchdog_fired = 1;
+
+    static const char message[] = "watchdog reset\n";
+    write(STDERR_FILENO, message, sizeof(message) - 1);
+    _exit(3);
+}
+
+static void _watchdog_update(void) {
+    struct itimerval timer = { .it_value = { WATCHDOG_TIMEOUT_MS / 1000, (WATCHDOG_TIMEOUT_MS % 1000) * 1000 } };
+    setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+static void _init_postmortem(void) {
+    const char *path = getenv("CHEATBOX_POSTMORTEM");
+    if (path) {
+        int fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (fd >= 0 && ftruncate(fd, sizeof(_PostMortemFile)) == 0) {
+            void *mapped = mmap(NULL, sizeof(_PostMortemFile), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (mapped != MAP_FAILED) _postmortem = mapped;
+        }
+        if (fd >= 0) close(fd);
+    }
+
+    postmortem_init(&_postmortem->log, _postmortem->watchdog_fired);
+    _postmortem->watchdog_fired = 0;
+
+    const PostMortemLog *previous = postmortem_previous();
+    if (_trace && previous) {
+        const PostMortemBoot *boot = &previous->boot;
+        fprintf(stderr, "previous boot: watchdog_reset %u task %u stage %u frame %u overruns %u\n",
+                boot->watchdog_reset, boot->task, boot->stage, boot->frame, boot->overruns);
+        for (int i = 0; i < POSTMORTEM_SLOWEST && boot->slowest[i].total_us; ++i) {
+            const PostMortemFrame *frame = &boot->slowest[i];
+            fprintf(stderr, "  slow frame %u total_us %u read %u scan %u frame %u\n", frame->frame, frame->total_us,
+                    frame->stage_us[POSTMORTEM_STAGE_READ], frame->stage_us[POSTMORTEM_STAGE_SCAN],
+                    frame->stage_us[POSTMORTEM_STAGE_FRAME]);
+        }
+    }
+
+    signal(SIGALRM, _on_watchdog);
+    _watchdog_update();
+}
+
+static void _sleep_for(u32 us) {
+    struct timespec ts = {
+        .tv_sec = us / 1000000,
+        .tv_nsec = (us % 1000000) * 1000,
+    };
+    clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL);
+}
+
+static void _print_stats(void) {
+    FrameStats frames = platform_frame_stats();
+    fprintf(stderr, "frames %u evaluated %u skipped %u eval_us %u\n",
+            frames.frames, frames.evaluated, frames.skipped, frames.eval_us);
+
+    u8 buffer[1 + SCHEDULER_MAX_TASKS * sizeof(SchedulerTaskStats)];
+    scheduler_read_stats(buffer, sizeof(buffer));
+    for (u8 i = 0; i < buffer[0]; ++i) {
+        SchedulerTaskStats task;
+        memcpy(&task, buffer + 1 + i * sizeof(task), sizeof(task));
+        fprintf(stderr, "task %u runs %u misses %u max_late_us %u\n", i, task.runs, task.misses, task.max_late_us);
+    }
+
+    u8 sources[1 + INPUT_SOURCE_MAX * sizeof(InputSourceStats)];
+    input_sources_read_stats(sources, sizeof(sources));
+    for (u8 i = 0; i < sources[0]; ++i) {
+        InputSourceStats source;
+        memcpy(&source, sources + 1 + i * sizeof(source), sizeof(source));
+        fprintf(stderr, "source %u age_us %u max_age_us %u max_read_us %u\n",
+                i, source.last_age_us, source.max_age_us, source.max_read_us);
+    }
+}
+
+// Stands in for the pico pins, sampled during the scan
+static u32 _mock_gpio_read(u32 *sample_us) {
+    (void) sample_us;
+    return (u32) _inputs;
+}
+
+// Stands in for an expander read by dma in the background. Inputs 32-63 are copied after every scan, so the scan
+// sees them one frame late like it would with real hardware started at the same point.
+static void _mock_expander_start(void) {
+    _expander_sample = (u32) (_inputs >> 32);
+    _expander_sample_us = _now_us();
+}
+
+static u32 _mock_expander_read(u32 *sample_us) {
+    *sample_us = _expander_sample_us;
+    return _expander_sample;
+}
+
+static const InputSource _sources[] = {
+    { _mock_gpio_read,     NULL,                 0,  32 },
+    { _mock_expander_read, _mock_expander_start, 32, 32 },
+};
+
+static void _hid_task(void) {
+    postmortem_stage(POSTMORTEM_STAGE_READ, _now_us());
+    bool running = input_poll(&_inputs, _edge_us, &_stamped);
+
+    u32 scan_us = _now_us();
+    InputMask buttons = input_sources_read(scan_us, _stamped, _edge_us);
+
+    postmortem_stage(POSTMORTEM_STAGE_SCAN, _now_us());
+    device_scan(buttons, false, scan_us, _edge_us);
+
+    postmortem_stage(POSTMORTEM_STAGE_FRAME, _now_us());
+    if (_opened) device_frame(_callback);
+    input_sources_start();
+    postmortem_frame_end(platform_frame(), _now_us());
+
+    if (!running) {
+        if (_trace) _print_stats();
+
+        fflush(stdout);
+        exit(0);
+    }
+}
+
+// Highest priority first. There is no bootsel or led to service here.
+static const SchedulerTask _tasks[] = {
+    { _hid_task,           POLLING_RATE * 1000,  SCAN_DEADLINE_US, 0 },
+    { uhid_task,           0,                    0,                0 },
+    { _deferred_init_task, 0,                    0,                0 },
+    { stats_task,          STATS_TASK_MS * 1000, 0,                0 },
+    { plugin_task,         0,                    0,                0 },
+};
+
+_Static_assert(array_len(_tasks) <= SCHEDULER_MAX_TASKS, "Too many tasks, raise SCHEDULER_MAX_TASKS");
+
+void platform_init(TaskCallback deferred_init) {
+    _deferred_init = deferred_init;
+    _origin_us = input_clock_us();
+    _trace = getenv("CHEATBOX_TRACE") != NULL;
+
+    if (!input_init(_origin_us)) exit(1);
+    _mark_boot_phase(BOOT_PHASE_PINS);
+
+    const char *uhid = getenv("CHEATBOX_UHID");
+    if (!uhid) uhid = "/dev/uhid";
+
+    if (strcmp(uhid, "none") == 0) {
+        // Without a device there is no host to wait for
+        _started = true;
+        _opened = true;
+    }
+    else {
+        _has_uhid = uhid_init(uhid, _desc_hid_report, sizeof(_desc_hid_report));
+        if (!_has_uhid) exit(1);
+    }
+    _mark_boot_phase(BOOT_PHASE_USB_INIT);
+
+    stats_init();
+    input_sources_init(_sources, array_len(_sources));
+    scheduler_init(_tasks, array_len(_tasks), _now_us());
+    _init_postmortem();
+}
+
+void platform_task(TaskCallback callback, bool save_power) {
+    _callback = callback;
+
+    // Unlike the pico there is nothing to gain from spinning, the kernel wakes us late either way
+    (void) save_power;
+    u32 idle_us = scheduler_run();
+    _watchdog_update();
+    if (idle_us > 0) _sleep_for(idle_us);
+}
+
+// uhid callbacks
+void uhid_start_cb(void) {
+    _started = true;
+    _mark_boot_phase(BOOT_PHASE_MOUNTED);
+}
+
+void uhid_open_cb(bool open) {
+    _opened = open;
+}
+
+u16 uhid_get_report_cb(u8 report_id, UhidReportType type, u8 *buffer, u16 reqlen) {
+    if (report_id == REPORT_ID_VENDOR && type == UHID_REPORT_TYPE_FEATURE) {
+        return vendor_get_report(buffer, reqlen < VENDOR_REPORT_SIZE ? reqlen : VENDOR_REPORT_SIZE);
+    }
+
+    return 0;
+}
+
+void uhid_set_report_cb(u8 report_id, UhidReportType type, const u8 *buffer, u16 bufsize) {
+    if (report_id == REPORT_ID_VENDOR && type == UHID_REPORT_TYPE_FEATURE) {
+        vendor_set_report(buffer, bufsize);
+    }
+
+    if (report_id == REPORT_ID_KEYBOARD && type == UHID_REPORT_TYPE_OUTPUT) {
+        device_keyboard_output(buffer, bufsize, backend_time_us());
+    }
+}
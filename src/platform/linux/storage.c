@@ -0,0 +1,38 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../storage.h"
+
+// Each slot is a file in CHEATBOX_STORAGE_DIR (default: working directory)
+static void _path(StorageSlot slot, char *path, size_t size) {
+    const char *dir = getenv("CHEATBOX_STORAGE_DIR");
+    snprintf(path, size, "%s/cheatbox-slot-%d.bin", dir ? dir : ".", (int) slot);
+}
+
+bool storage_read(StorageSlot slot, void *data, u32 size) {
+    if (slot >= STORAGE_SLOT_COUNT) return false;
+
+    char path[512];
+    _path(slot, path, sizeof(path));
+
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+
+    // The blob must have exactly the requested size
+    bool ok = fread(data, 1, size, file) == size && fgetc(file) == EOF;
+    fclose(file);
+    return ok;
+}
+
+bool storage_write(StorageSlot slot, const void *data, u32 size) {
+    if (slot >= STORAGE_SLOT_COUNT) return false;
+
+    char path[512];
+    _path(slot, path, sizeof(path));
+
+    FILE *file = fopen(path, "wb");
+    if (!file) return false;
+
+    bool ok = fwrite(data, 1, size, file) == size;
+    return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,116 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <linux/uhid.h>
+
+#include "uhid.h"
+
+#define _VENDOR_ID  0xCafe
+#define _PRODUCT_ID 0x4004
+
+static int _fd = -1;
+
+static bool _write(const struct uhid_event *event) {
+    ssize_t written = write(_fd, event, sizeof(*event));
+    return written == (ssize_t) sizeof(*event);
+}
+
+static UhidReportType _report_type(u8 rtype) {
+    switch (rtype) {
+        case UHID_FEATURE_REPORT: return UHID_REPORT_TYPE_FEATURE;
+        case UHID_OUTPUT_REPORT:  return UHID_REPORT_TYPE_OUTPUT;
+        default:                  return UHID_REPORT_TYPE_INPUT;
+    }
+}
+
+bool uhid_init(const char *path, const u8 *descriptor, u16 size) {
+    _fd = open(path, O_RDWR | O_CLOEXEC | O_NONBLOCK);
+    if (_fd < 0) {
+        fprintf(stderr, "cheatbox: can't open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    struct uhid_event event = {0};
+    event.type = UHID_CREATE2;
+    snprintf((char *) event.u.create2.name, sizeof(event.u.create2.name), "Oats Cheatbox");
+    snprintf((char *) event.u.create2.phys, sizeof(event.u.create2.phys), "cheatbox-linux");
+    memcpy(event.u.create2.rd_data, descriptor, size);
+    event.u.create2.rd_size = size;
+    event.u.create2.bus = BUS_USB;
+    event.u.create2.vendor = _VENDOR_ID;
+    event.u.create2.product = _PRODUCT_ID;
+    event.u.create2.version = 0x0100;
+
+    if (!_write(&event)) {
+        fprintf(stderr, "cheatbox: can't create uhid device: %s\n", strerror(errno));
+        close(_fd);
+        _fd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+void uhid_task(void) {
+    if (_fd < 0) return;
+
+    struct uhid_event event;
+    while (read(_fd, &event, sizeof(event)) > 0) {
+        switch (event.type) {
+            case UHID_START: uhid_start_cb();       break;
+            case UHID_OPEN:  uhid_open_cb(true);    break;
+            case UHID_CLOSE: uhid_open_cb(false);   break;
+
+            case UHID_GET_REPORT: {
+                struct uhid_event reply = {0};
+                reply.type = UHID_GET_REPORT_REPLY;
+                reply.u.get_report_reply.id = event.u.get_report.id;
+
+                // Like a real usb device the reply starts with the report id
+                u8 *data = reply.u.get_report_reply.data;
+                data[0] = event.u.get_report.rnum;
+                u16 len = uhid_get_report_cb(event.u.get_report.rnum, _report_type(event.u.get_report.rtype),
+                                             data + 1, UHID_DATA_MAX - 1);
+
+                reply.u.get_report_reply.err = len ? 0 : EIO;
+                reply.u.get_report_reply.size = len ? len + 1 : 0;
+                _write(&reply);
+            } break;
+
+            case UHID_SET_REPORT: {
+                const u8 *data = event.u.set_report.data;
+                u16 size = event.u.set_report.size;
+                u8 report_id = event.u.set_report.rnum;
+
+                if (report_id && size && data[0] == report_id) { data += 1; size -= 1; }
+                uhid_set_report_cb(report_id, _report_type(event.u.set_report.rtype), data, size);
+
+                struct uhid_event reply = {0};
+                reply.type = UHID_SET_REPORT_REPLY;
+                reply.u.set_report_reply.id = event.u.set_report.id;
+                _write(&reply);
+            } break;
+
+            case UHID_OUTPUT: {
+                const u8 *data = event.u.output.data;
+                u16 size = event.u.output.size;
+                if (size == 0) break;
+
+                uhid_set_report_cb(data[0], _report_type(event.u.output.rtype), data + 1, size - 1);
+            } break;
+        }
+    }
+}
+
+bool uhid_send(u8 report_id, const void *report, u16 len) {
+    if (_fd < 0 || len + 1 > UHID_DATA_MAX) return false;
+
+    struct uhid_event event = {0};
+    event.type = UHID_INPUT2;
+    event.u.input2.data[0] = report_id;
+    memcpy(event.u.input2.data + 1, report, len);
+    event.u.input2.size = len + 1;
+
+    return _write(&event);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+// Virtual hid device through /dev/uhid. Kept apart from platform.c because the linux headers define
+// KEY_* macros that clash with keycodes.h.
+
+#include "../../common.h"
+
+typedef enum {
+    UHID_REPORT_TYPE_INPUT,
+    UHID_REPORT_TYPE_OUTPUT,
+    UHID_REPORT_TYPE_FEATURE,
+} UhidReportType;
+
+// Creates the device with the given report descriptor. Returns false if /dev/uhid can't be opened.
+bool uhid_init(const char *path, const u8 *descriptor, u16 size);
+
+// Handles pending kernel events without blocking, dispatching them to the callbacks below
+void uhid_task(void);
+
+// Sends an input report, the report id is prepended here like tinyusb does
+bool uhid_send(u8 report_id, const void *report, u16 len);
+
+// Callbacks implemented by the platform, named after their tinyusb counterparts
+void uhid_start_cb(void);
+void uhid_open_cb(bool open);
+u16 uhid_get_report_cb(u8 report_id, UhidReportType type, u8 *buffer, u16 reqlen);
+void uhid_set_report_cb(u8 report_id, UhidReportType type, const u8 *buffer, u16 bufsize);
@@ -1,12 +1,39 @@
 #include <string.h>
 #include <bsp/board.h>
 #include <hardware/gpio.h>
+#include <hardware/irq.h>
+#include <hardware/pwm.h>
+#include <hardware/sync.h>
+#include <hardware/structs/iobank0.h>
+#include <hardware/structs/padsbank0.h>
+#include <hardware/structs/sio.h>
+#include <hardware/structs/systick.h>
+#include <hardware/watchdog.h>
 #include <pico/stdlib.h>
 #include <tusb.h>
 
+#include "../plugin.h"
 #include "../settings.h"
-#include "platform.h"
+#include "../stats.h"
+#include "../vendor.h"
+#include "analog_input.h"
+#include "device.h"
+#include "input_source.h"
+#include "postmortem.h"
 #include "report_ids.h"
+#include "scheduler.h"
+#include "shift_register.h"
+#include "usb_descriptors.h"
+
+#if SHIFT_REGISTER_INPUTS
+#define _SHIFT_REGISTER_PINS \
+    ((1u << SHIFT_REGISTER_LOAD_PIN) | (1u << SHIFT_REGISTER_CLOCK_PIN) | (1u << SHIFT_REGISTER_DATA_PIN))
+#else
+#define _SHIFT_REGISTER_PINS 0
+#endif
+
+// The gpio the board descriptor wires to buttons. Analog pins are left to the adc and the shift register pins to the chain.
+#define _BUTTON_PIN_MASK (board_gpio_mask & ~(u32) ANALOG_PINS & ~(u32) _SHIFT_REGISTER_PINS)
 
 enum  {
     BLINK_NOT_MOUNTED = 250,
@@ -14,342 +41,314 @@ enum  {
     BLINK_SUSPENDED = 2500,
 };
 
-// Tiny usb handles the report ID so i dont need to include it in the packet.
-typedef struct TU_ATTR_PACKED
-{
-  u8 modifier;
-  u8 keycode[12];
-} _NKROKeyboardReport;
-
-typedef struct TU_ATTR_PACKED {
-    i8 lx;
-    i8 ly; // left stick
-
-    i8 rx;
-    i8 ry; // right stick
-
-    i8 lt;
-    i8 rt; // left/right trigger
-    
-    u8 dpad;
-
-    u32 buttons;
-} _GamepadReport;
-
-typedef struct {
-    InputMode mode;
-
-    // true if there is keyboard input to report
-    bool has_keyboard_input;
-
-    // true if there is gamepad input to report
-    bool has_gamepad_input;
-    
-    // States of the physical buttons
-    uint32_t b_new;
-    uint32_t b_old;
+#if USB_REENUMERATE
+// Steps of the re-enumeration after a polling rate change
+typedef enum {
+    _REENUMERATE_IDLE,
+    _REENUMERATE_DISCONNECT,
+    _REENUMERATE_WAIT,
+} _ReenumerateState;
+#endif
 
-    bool board_button_new;
-    bool board_button_old;
+// Index of the scan in _tasks
+#define _HID_TASK 0
 
-    bool clean_report;
-
-    // USB report structs
-    _NKROKeyboardReport keyboard;
-    _GamepadReport gamepad;
-} _DeviceState;
+// Led brightness out of 0xFFFF
+#define _LED_LEVEL 0x4000
 
 static u32 blink_interval_ms = BLINK_NOT_MOUNTED;
-static _DeviceState _device = {0};
-
-static void _init_pin(int pin) {
-    gpio_init(pin);
-    gpio_set_dir(pin, GPIO_IN);
-    gpio_pull_up(pin);
-}
-
-static void _init_pins(void) {
-    for (int gpio = 0; gpio <= 22; ++gpio) {
-        _init_pin(gpio);
-    }
+static bool _deferred_init_done = false;
 
-    for (int gpio = 26; gpio <= 28; ++gpio) {
-        _init_pin(gpio);
-    }
-}
+// Latest bootsel sample, read at BOOTSEL_SAMPLE_MS in slack time
+static bool _board_button = false;
 
-void platform_init(void) {
-    board_init();
-    tusb_init();
-    _init_pins();
+// User callback of the current platform_task call
+static TaskCallback _callback = NULL;
 
-    _device.mode = MODE_KEYBOARD;
-}
+// Time of the first edge seen on each input since the last scan. Written from the gpio interrupt for the pins
+// so the order of presses inside the same scan interval is not lost, the input sources stamp everything else.
+static volatile u32 _edge_us[INPUT_COUNT];
+static volatile u32 _edge_pending = 0;
+// Edge times of the scan in progress: the interrupt's, copied out with interrupts off, and the sources' own
+static u32 _scan_edge_us[INPUT_COUNT];
 
-void platform_set_mode(InputMode mode) {
-    _device.clean_report = true;
-    _device.mode = mode;
-}
+// Pressed analog pins of the current scan, merged into the gpio source
+static u32 _analog = 0;
+// Raw gpio levels of the current scan, the pins are re-armed from the same sample that is reported
+static u32 _gpio_sample = 0;
 
-InputMode platform_get_mode(void) {
-    return _device.mode;
-}
+// User init that is postponed until the device is enumerated
+static TaskCallback _deferred_init = NULL;
 
-static void _led_blinking_task(void)
-{
-    static u32 start_ms = 0;
-    static bool led_state = false;
+#if USB_REENUMERATE
+static _ReenumerateState _reenumerate = _REENUMERATE_IDLE;
+static u32 _reconnect_us = 0;
+#endif
 
-    if (board_millis() - start_ms < blink_interval_ms) return;
-    start_ms += blink_interval_ms;
+// Kept out of .bss so the runtime doesn't clear it and it outlives a watchdog reset
+static PostMortemLog __uninitialized_ram(_postmortem);
 
-    board_led_write(led_state);
-    led_state = 1 - led_state;
+// The timer starts shortly after reset so its value is the time since boot
+static void _mark_boot_phase(BootPhase phase) {
+    device_mark_boot_phase(phase, time_us_32());
 }
 
-static void _send_keyboard_input(void) {
-    static bool had_input = false;
+// Edges are kept by button like the rest of the input state. Only the first edge of a change is wanted, so the pin
+// is disarmed until the next scan and the bounce after it never interrupts anything.
+static void _gpio_edge_callback(uint gpio, u32 events) {
+    (void) events;
+    gpio_set_irq_enabled(gpio, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, false);
 
-    if (_device.clean_report) {
-        // Send last clean gamepad report when changing modes
-        _device.clean_report = false;
-        memset(&_device.gamepad, 0, sizeof(_device.gamepad));
-        tud_hid_report(REPORT_ID_GAMEPAD, &_device.gamepad, sizeof(_device.gamepad));
-        return;
-    }
+    u8 button = board_button_of_gpio((u8) gpio);
+    if (button == BOARD_NO_BUTTON) return;
 
-    if (_device.has_keyboard_input) {
-        had_input = true;
-        tud_hid_report(REPORT_ID_KEYBOARD, &_device.keyboard, sizeof(_device.keyboard));
-    }
-    else {
-        if (had_input) {
-            // Send empty report
-            memset(&_device.keyboard, 0, sizeof(_device.keyboard));
-            tud_hid_report(REPORT_ID_KEYBOARD, &_device.keyboard, sizeof(_device.keyboard));
-        }
+    u32 bit = 1u << button;
+    if (_edge_pending & bit) return;
 
-        had_input = false;
-    }
+    _edge_us[button] = time_us_32();
+    _edge_pending |= bit;
 }
 
-static void _send_gamepad_input(void) {
-    static bool had_input = false;
+// Arms every button pin for the one edge that leaves the level it has in gpio, a raw sample of the pins.
+// Pins that weren't armed for that edge yet may hold edges latched while they were disarmed, those are dropped.
+static void _arm_edges(u32 gpio) {
+    u32 inte[4] = {0};
+    u32 stale[4] = {0};
+    u32 armed[4];
+    for (int i = 0; i < 4; ++i) armed[i] = iobank0_hw->proc0_irq_ctrl.inte[i];
 
-    if (_device.clean_report) {
-        // Send a last clean keyboard report when changing modes
-        _device.clean_report = false;
-        memset(&_device.keyboard, 0, sizeof(_device.keyboard));
-        tud_hid_report(REPORT_ID_KEYBOARD, &_device.keyboard, sizeof(_device.keyboard));
-        return;
-    }
+    for (u32 pins = _BUTTON_PIN_MASK; pins; pins &= pins - 1) {
+        int pin = __builtin_ctz(pins);
+        u32 shift = 4 * (pin % 8);
 
-    if (_device.has_gamepad_input) {
-        had_input = true;
-        tud_hid_report(REPORT_ID_GAMEPAD, &_device.gamepad, sizeof(_device.gamepad));
+        // The buttons pull the pin low, a released pin waits for the fall
+        u32 edge = (gpio & (1u << pin) ? GPIO_IRQ_EDGE_FALL : GPIO_IRQ_EDGE_RISE) << shift;
+        inte[pin / 8] |= edge;
+        if (!(armed[pin / 8] & edge)) stale[pin / 8] |= (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL) << shift;
     }
-    else {
-        if (had_input) {
-            // Send empty report
-            memset(&_device.gamepad, 0, sizeof(_device.gamepad));
-            tud_hid_report(REPORT_ID_GAMEPAD, &_device.gamepad, sizeof(_device.gamepad));
-        }
 
-        had_input = false;
+    for (int i = 0; i < 4; ++i) {
+        iobank0_hw->intr[i] = stale[i];
+        iobank0_hw->proc0_irq_ctrl.inte[i] = inte[i];
     }
 }
 
-static void _hid_task(TaskCallback callback, bool save_power) {
-    // timer
-    u64 interval_us = POLLING_RATE * 1000;
-    static u64 start_us = 0;
-    u64 time = time_us_64() - start_us;
-
-    if (time < interval_us) {
-        u64 sleep_time = interval_us - time;
-        
-        // If the sleep time is greater than 50us save power. Otherwise busy wait.
-        if (sleep_time > 50 && save_power) {
-            sleep_us(sleep_time - 50);
-        }
-
-        return;
-    }
-    start_us += interval_us;
-
-    _device.b_old = _device.b_new;
-    _device.b_new = ~gpio_get_all();
+// The sio and interrupt enable registers are written once for all pins, only the pads need a store per pin.
+static void _init_pins(void) {
+    sio_hw->gpio_oe_clr = _BUTTON_PIN_MASK;
+    sio_hw->gpio_clr = _BUTTON_PIN_MASK;
 
-    _device.board_button_old = _device.board_button_new;
-    _device.board_button_new = board_button_read();
+    for (u32 pins = _BUTTON_PIN_MASK; pins; pins &= pins - 1) {
+        int pin = __builtin_ctz(pins);
 
-    // If the device is suspended and an input was detected, wake it up
-    if (tud_suspended() && has_input()) {
-        tud_remote_wakeup();
-        return;
+        padsbank0_hw->io[pin] = PADS_BANK0_GPIO0_IE_BITS | PADS_BANK0_GPIO0_PUE_BITS | PADS_BANK0_GPIO0_SCHMITT_BITS |
+                                (PADS_BANK0_GPIO0_DRIVE_VALUE_4MA << PADS_BANK0_GPIO0_DRIVE_LSB);
+        iobank0_hw->io[pin].ctrl = GPIO_FUNC_SIO << IO_BANK0_GPIO0_CTRL_FUNCSEL_LSB;
     }
 
-    if (!tud_hid_ready()) return;
-
-    // Callback to user input handling code
-    callback();
+    // Drop edges latched while the pins were floating
+    for (int i = 0; i < 4; ++i) iobank0_hw->proc0_irq_ctrl.inte[i] = 0;
+    for (int i = 0; i < 4; ++i) iobank0_hw->intr[i] = 0xFFFFFFFF;
+    _arm_edges(gpio_get_all());
 
-    switch (_device.mode) {
-        case MODE_KEYBOARD: _send_keyboard_input(); break;
-        case MODE_GAMEPAD:  _send_gamepad_input();  break;
-    }
-
-    // Clear everything after consuming them
-    _device.has_keyboard_input = false;
-    _device.has_gamepad_input = false;
-    memset(&_device.keyboard, 0, sizeof(_device.keyboard));
-    memset(&_device.gamepad, 0, sizeof(_device.gamepad));
+    gpio_set_irq_callback(_gpio_edge_callback);
+    irq_set_enabled(IO_IRQ_BANK0, true);
 }
 
-void platform_task(TaskCallback callback, bool save_power) {
-    tud_task();
-    _led_blinking_task();
-    _hid_task(callback, save_power);
+// Runs from the sdk runtime init before main so the pull-ups are stable before usb or anything else comes up
+static void __attribute__((constructor)) _early_init(void) {
+    _init_pins();
+    _mark_boot_phase(BOOT_PHASE_PINS);
 }
 
-bool has_input(void) {
-    return _device.b_new || _device.b_old;
+// The led is left to the pwm slice so the blink task is a single register write
+static void _init_led(void) {
+#ifdef PICO_DEFAULT_LED_PIN
+    gpio_set_function(PICO_DEFAULT_LED_PIN, GPIO_FUNC_PWM);
+    pwm_config config = pwm_get_default_config();
+    pwm_init(pwm_gpio_to_slice_num(PICO_DEFAULT_LED_PIN), &config, true);
+#endif
 }
 
-bool button_down(int index) {
-    if (index > 31) return false;
-    return !!(_device.b_new & (1 << index));
-}
+static void _deferred_init_task(void) {
+    if (_deferred_init_done || !tud_mounted()) return;
+    _deferred_init_done = true;
 
-bool button_up(int index) {
-    if (index > 31) return false;
-    return !(_device.b_new & (1 << index));
-}
+    // The led and the uart are not needed for enumeration or the first report.
+    // board_init routes the debug uart to gpio 0 and 1 so take the button pins back afterwards.
+    board_init();
+    _init_pins();
+    _init_led();
+    if (_deferred_init) _deferred_init();
 
-bool button_pressed(int index) {
-    if (index > 31) return false;
-    return (_device.b_new & (1 << index)) && !(_device.b_old & (1 << index));
+    _mark_boot_phase(BOOT_PHASE_DEFERRED_INIT);
 }
 
-bool button_released(int index) {
-    if (index > 31) return false;
-    return !(_device.b_new & (1 << index)) && (_device.b_old & (1 << index));
+u32 backend_time_us(void) {
+    return time_us_32();
 }
 
-bool board_button_down(void) {
-    return _device.board_button_new;
+u32 backend_cycles(void) {
+    // Systick counts down
+    return BACKEND_CYCLES_MASK - systick_hw->cvr;
 }
 
-bool board_button_up(void) {
-    return !_device.board_button_new;
+void backend_send_report(u8 report_id, const void *report, u16 len) {
+    tud_hid_report(report_id, report, len);
+    _mark_boot_phase(BOOT_PHASE_FIRST_REPORT);
 }
 
-bool board_button_pressed(void) {
-    return _device.board_button_new && !_device.board_button_old;
+void backend_set_polling(u8 ms) {
+    usb_descriptors_set_interval(ms);
+    scheduler_set_period(_HID_TASK, ms * 1000);
+
+#if USB_REENUMERATE
+    // Called from inside the frame, the report of this frame is still queued before the box goes away
+    _reenumerate = _REENUMERATE_DISCONNECT;
+#endif
 }
 
-bool board_button_released(void) {
-    return !_device.board_button_new && _device.board_button_old;
+static u32 _gpio_read(u32 *sample_us) {
+    (void) sample_us;
+    return board_remap((~_gpio_sample & _BUTTON_PIN_MASK) | _analog);
 }
 
-void keyboard_press(KeyCode key) {
-    if (
-        key > KEY_GUI_RIGHT ||
-        key < KEY_A ||
-        (key > KEY_KEYPAD_DECIMAL && key < KEY_CONTROL_LEFT)
-    ) return;
+static const InputSource _sources[] = {
+    { _gpio_read, NULL, 0, BUTTON_COUNT },
+#if SHIFT_REGISTER_INPUTS
+    { shift_register_read, NULL, 32, SHIFT_REGISTER_INPUTS },
+#endif
+};
+
+static void _hid_task(void) {
+    postmortem_stage(POSTMORTEM_STAGE_READ, time_us_32());
+#if ANALOG_PINS
+    _analog = analog_input_scan();
+#endif
 
-    _device.has_keyboard_input = true;
+    // Sample the pins and take the edge times atomically so no edge is lost between the two. Only that is done with
+    // interrupts off, the sources and the scan run on the copies.
+    u32 irq = save_and_disable_interrupts();
+    u32 scan_us = time_us_32();
+    _gpio_sample = gpio_get_all();
+    u32 pending = _edge_pending;
+    for (u32 p = pending; p; p &= p - 1) _scan_edge_us[__builtin_ctz(p)] = _edge_us[__builtin_ctz(p)];
+    _edge_pending = 0;
+    _arm_edges(_gpio_sample);
+    restore_interrupts(irq);
 
-    if (key > KEY_KEYPAD_DECIMAL) {
-        _device.keyboard.modifier |= 1 << (key - KEY_CONTROL_LEFT);
-    }
-    else {
-        _device.keyboard.keycode[((key - KEY_A) / 8)] |= 1 << ((key - KEY_A) % 8);
-    }
-}
+    InputMask buttons = input_sources_read(scan_us, pending, _scan_edge_us);
 
-void keyboard_release(KeyCode key) {
-    if (
-        key > KEY_GUI_RIGHT ||
-        key < KEY_A ||
-        (key > KEY_KEYPAD_DECIMAL && key < KEY_CONTROL_LEFT)
-    ) return;
+    postmortem_stage(POSTMORTEM_STAGE_SCAN, time_us_32());
+    device_scan(buttons, _board_button, scan_us, _scan_edge_us);
 
-    _device.has_keyboard_input = true;
+    postmortem_stage(POSTMORTEM_STAGE_FRAME, time_us_32());
 
-    if (key > KEY_KEYPAD_DECIMAL) {
-        _device.keyboard.modifier &= ~(1 << (key - KEY_CONTROL_LEFT));
+    // If the device is suspended and an input was detected, wake it up
+    if (tud_suspended() && has_input()) {
+        tud_remote_wakeup();
     }
-    else {
-        _device.keyboard.keycode[((key - KEY_A) / 8)] &= ~(1 << ((key - KEY_A) % 8));
+    else if (tud_hid_ready()) {
+        device_frame(_callback);
     }
-}
 
-void keyboard_release_all(void) {
-    _device.has_keyboard_input = true;
-    memset(&_device.keyboard, 0, sizeof(_device.keyboard));
+    postmortem_frame_end(platform_frame(), time_us_32());
 }
 
-void gamepad_left_stick(i8 x, i8 y) {
-    _device.has_gamepad_input = true;
-    _device.gamepad.lx = x;
-    _device.gamepad.ly = y;
+// Reading bootsel floats the flash chip select with interrupts off, which stalls anything running from flash
+static void _bootsel_task(void) {
+    _board_button = board_button_read();
 }
 
-void gamepad_left_stick_x(i8 x) {
-    _device.has_gamepad_input = true;
-    _device.gamepad.lx = x;
-}
+#if USB_REENUMERATE
+// Pulls the pull-up off the bus for USB_REENUMERATE_MS so the host drops the device and enumerates it again,
+// reading the configuration descriptor with the new bInterval. A change while waiting restarts the wait.
+static void _reenumerate_task(void) {
+    switch (_reenumerate) {
+        case _REENUMERATE_IDLE:
+            break;
 
-void gamepad_left_stick_y(i8 y) {
-    _device.has_gamepad_input = true;
-    _device.gamepad.ly = y;
-}
+        case _REENUMERATE_DISCONNECT:
+            tud_disconnect();
+            _reconnect_us = time_us_32() + USB_REENUMERATE_MS * 1000;
+            _reenumerate = _REENUMERATE_WAIT;
+            break;
 
-void gamepad_right_stick(i8 x, i8 y) {
-    _device.has_gamepad_input = true;
-    _device.gamepad.rx = x;
-    _device.gamepad.ry = y;
+        case _REENUMERATE_WAIT:
+            if ((i32)(time_us_32() - _reconnect_us) < 0) break;
+            tud_connect();
+            _reenumerate = _REENUMERATE_IDLE;
+            break;
+    }
 }
+#endif
+
+static void _led_task(void) {
+#ifdef PICO_DEFAULT_LED_PIN
+    if (!_deferred_init_done) return;
+
+    bool on = (time_us_32() / 1000 / blink_interval_ms) & 1;
+    pwm_set_gpio_level(PICO_DEFAULT_LED_PIN, on ? _LED_LEVEL : 0);
+#endif
+}
+
+// Highest priority first, the scan is _HID_TASK
+static const SchedulerTask _tasks[] = {
+    { _hid_task,           POLLING_RATE * 1000,        SCAN_DEADLINE_US, 0 },
+    { tud_task,            0,                          0,                0 },
+    { _deferred_init_task, 0,                          0,                0 },
+#if USB_REENUMERATE
+    { _reenumerate_task,   0,                          0,                0 },
+#endif
+    { _bootsel_task,       BOOTSEL_SAMPLE_MS * 1000,   0,                50 },
+    { _led_task,           LED_UPDATE_MS * 1000,       0,                20 },
+    { stats_task,          STATS_TASK_MS * 1000,       0,                0 },
+    { plugin_task,         0,                          0,                0 },
+};
 
-void gamepad_right_stick_x(i8 x) {
-    _device.has_gamepad_input = true;
-    _device.gamepad.rx = x;
-}
+_Static_assert(array_len(_tasks) <= SCHEDULER_MAX_TASKS, "Too many tasks, raise SCHEDULER_MAX_TASKS");
 
-void gamepad_right_stick_y(i8 y) {
-    _device.has_gamepad_input = true;
-    _device.gamepad.ry = y;
-}
+void platform_init(TaskCallback deferred_init) {
+    _deferred_init = deferred_init;
 
-void gamepad_left_trigger(i8 strength) {
-    _device.has_gamepad_input = true;
-    _device.gamepad.rx = strength;
-}
+    tusb_init();
+    _mark_boot_phase(BOOT_PHASE_USB_INIT);
 
-void gamepad_right_trigger(i8 strength) {
-    _device.has_gamepad_input = true;
-    _device.gamepad.ry = strength;
-}
+    stats_init();
+#if ANALOG_PINS
+    analog_input_init();
+#endif
+#if SHIFT_REGISTER_INPUTS
+    shift_register_init();
+#endif
+    input_sources_init(_sources, array_len(_sources));
+    scheduler_init(_tasks, array_len(_tasks), time_us_32());
 
-void gamepad_dpad(DPadDirection direction) {
-    _device.has_gamepad_input = true;
-    _device.gamepad.dpad = direction;
-}
+    // Free running on the cpu clock for backend_cycles, without the interrupt
+    systick_hw->rvr = BACKEND_CYCLES_MASK;
+    systick_hw->cvr = 0;
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
 
-void gamepad_button_press(u32 button) {
-    _device.has_gamepad_input = true;
-    _device.gamepad.buttons |= button;
+    // The log of the boot before this one is copied out before anything writes to it
+    postmortem_init(&_postmortem, watchdog_caused_reboot());
+    watchdog_enable(WATCHDOG_TIMEOUT_MS, true);
 }
 
-void gamepad_button_release(u32 button) {
-    _device.has_gamepad_input = true;
-    _device.gamepad.buttons &= ~button;
+void platform_task(TaskCallback callback, bool save_power) {
+    _callback = callback;
+
+    u32 idle_us = scheduler_run();
+    watchdog_update();
+
+    // If the idle time is greater than 50us save power. Otherwise busy wait.
+    if (idle_us > 50 && save_power) {
+        sleep_us(idle_us - 50);
+    }
 }
 
 // TinyUSB Callbacks
 void tud_mount_cb(void) {
+    _mark_boot_phase(BOOT_PHASE_MOUNTED);
     blink_interval_ms = BLINK_MOUNTED;
 }
 
@@ -369,10 +368,10 @@ void tud_resume_cb(void) {
 u16 tud_hid_get_report_cb(u8 itf, u8 report_id, hid_report_type_t report_type, u8* buffer, u16 reqlen)
 {
     (void) itf;
-    (void) report_id;
-    (void) report_type;
-    (void) buffer;
-    (void) reqlen;    
+
+    if (report_id == REPORT_ID_VENDOR && report_type == HID_REPORT_TYPE_FEATURE) {
+        return vendor_get_report(buffer, reqlen);
+    }
 
     return 0;
 }
@@ -380,8 +379,19 @@ u16 tud_hid_get_report_cb(u8 itf, u8 report_id, hid_report_type_t report_type, u
 void tud_hid_set_report_cb(u8 itf, u8 report_id, hid_report_type_t report_type, u8 const* buffer, u16 bufsize)
 {
     (void) itf;
-    (void) report_id;
-    (void) report_type;
-    (void) buffer;
-    (void) bufsize;
+
+    if (report_id == REPORT_ID_VENDOR && report_type == HID_REPORT_TYPE_FEATURE) {
+        vendor_set_report(buffer, bufsize);
+    }
+
+    if (report_type == HID_REPORT_TYPE_OUTPUT) {
+        // Reports from the out endpoint still have their id in front
+        if (report_id == 0 && bufsize > 0) {
+            report_id = buffer[0];
+            buffer += 1;
+            bufsize -= 1;
+        }
+
+        if (report_id == REPORT_ID_KEYBOARD) device_keyboard_output(buffer, bufsize, time_us_32());
+    }
 }
@@ -2,35 +2,98 @@
 
 #include "keycodes.h"
 #include "gamepad_buttons.h"
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 typedef void (*TaskCallback)(void);
 
+// Physical inputs are numbered 0 to INPUT_COUNT - 1. The board's buttons are inputs 0-31 (board.h), expansion sources add the rest.
+#define INPUT_COUNT 64
+typedef u64 InputMask;
+#define INPUT_BIT(index) ((InputMask) 1 << (index))
+
 // Add some more input modes (xinput, DInput)
 typedef enum {
      MODE_KEYBOARD,
      MODE_GAMEPAD,
 } InputMode;
 
-void platform_init(void);
+// Boot milestones, readable over usb to measure how long a hot-plugged box takes to send its first report
+typedef enum {
+    BOOT_PHASE_PINS,          // Pins configured with pull-ups, before main
+    BOOT_PHASE_USB_INIT,      // Usb stack started
+    BOOT_PHASE_MOUNTED,       // Host finished enumeration
+    BOOT_PHASE_DEFERRED_INIT, // Board and user init finished
+    BOOT_PHASE_FIRST_REPORT,  // First input report queued
+
+    BOOT_PHASE_COUNT,
+} BootPhase;
+
+// How often the user callback actually ran, see platform_request_update
+typedef struct {
+    u32 frames;     // Frames handed to the usb stack
+    u32 evaluated;  // Frames where the user callback ran and a report was built
+    u32 skipped;    // Frames that reused the previous report
+    u32 eval_us;    // Total microseconds spent in evaluated frames
+} FrameStats;
+
+// deferred_init runs once the host has enumerated the device, for init that neither enumeration nor the first report
+// needs. NULL for none. Profiles build the first report, so they are not deferred.
+void platform_init(TaskCallback deferred_init);
 void platform_set_mode(InputMode mode);
 InputMode platform_get_mode(void);
+
+// Report interval in milliseconds, POLLING_RATE until changed. 1, 2, 4 and 8 are accepted, anything else is ignored.
+// The scan follows the new interval straight away and the configuration descriptor carries it from then on. The host
+// only reads the interval when it enumerates the device, so it keeps polling at the old one until the box is plugged
+// in again, or with USB_REENUMERATE until the box has dropped off the bus and come back.
+void platform_set_polling(u8 ms);
+u8 platform_get_polling(void);
+
 void platform_task(TaskCallback callback, bool save_power);
 
-// Physical button map
-/*
-              16
-         17 18 19 20
-         21 22 26 27
-              28
- 00 01 02 03      04 05 06 07
-                  08 09 10 11   
-        12 13    14 15
-*/
+// Runs on every scan before the inputs are latched, so everything reading the buttons (the temporal history and
+// the switch statistics too) sees what it returns. NULL passes the inputs through.
+typedef InputMask (*InputFilter)(InputMask buttons, u32 scan_us);
+void platform_set_input_filter(InputFilter filter);
+
+// Time of the current scan in microseconds since boot (wraps every ~71 minutes)
+u32 platform_time_us(void);
+// Number of scans since boot
+u32 platform_frame(void);
+
+// Counts frames where the usb stack could take a report, including the current one. The endpoint must be free for
+// this to advance, so it never moves faster than the host polls. Effects that must line up with what the host sees
+// (turbo) count in these ticks rather than in scans.
+u32 platform_report_tick(void);
+
+// Frames are only evaluated when the inputs, the mode or the profile changed. Anything that changes its output
+// with time alone (hold timers, taps...) must call this every frame it is active so the next frame is evaluated too.
+void platform_request_update(void);
+FrameStats platform_frame_stats(void);
+u16 platform_read_frame_stats(u8 *buffer, u16 len);
+
+// Stress test of the host, hub or port (see tools/stress_check.c). For the next frames reports every frame sends a
+// numbered test pattern in the current mode instead of the profile's output. Report n (counted from 0) holds:
+//   gamepad:  bit n % 32 of the buttons, n in the four stick axes (little endian)
+//   keyboard: no keys, the low 16 bits of n in the sequence of the REPORT_TIMING field
+// Returns false in keyboard mode without REPORT_TIMING. Pressing any button stops it early, 0 stops it now.
+bool platform_stress(u32 frames);
+// Writes [remaining u32, sent u32], the frames left and the reports sent since it was last started
+u16 platform_read_stress(u8 *buffer, u16 len);
+
+// Microseconds after reset at which the phase completed, 0 if it hasn't yet
+u32 platform_boot_time_us(BootPhase phase);
+u16 platform_read_boot_times(u8 *buffer, u16 len);
 
 // Returns true if any physical button is pressed or released
 bool has_input(void);
 
-// Physical button functions
+// Physical button functions, index is a button of board.h or an expansion input
+InputMask button_mask(void);
 bool button_down(int index);
 bool button_up(int index);
 bool button_pressed(int index);
@@ -57,3 +120,7 @@ void gamepad_right_trigger(i8 strength);
 void gamepad_dpad(DPadDirection direction);
 void gamepad_button_press(u32 button);
 void gamepad_button_release(u32 button);
+
+#ifdef __cplusplus
+}
+#endif
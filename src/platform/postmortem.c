@@ -0,0 +1,114 @@
+#include "postmortem.h"
+
+// "PMLG", anything else in the log memory is garbage from a power on
+#define _MAGIC 0x504D4C47u
+
+static PostMortemLog *_log = NULL;
+
+// Copy of the log as the previous boot left it
+static PostMortemLog _previous = {0};
+static bool _has_previous = false;
+
+// Frame being timed
+static PostMortemFrame _frame = {0};
+static u8 _stage = POSTMORTEM_STAGE_COUNT;
+static u32 _frame_us = 0;
+static u32 _stage_us = 0;
+
+static inline u16 _clamp_u16(u32 value) {
+    return value > 0xFFFF ? 0xFFFF : (u16) value;
+}
+
+void postmortem_init(PostMortemLog *log, bool watchdog_reset) {
+    _log = log;
+
+    if (log->magic == _MAGIC) {
+        _previous = *log;
+        _previous.boot.watchdog_reset = watchdog_reset;
+        _has_previous = true;
+
+        log->boots += 1;
+        if (watchdog_reset) log->watchdog_resets += 1;
+    }
+    else {
+        memset(log, 0, sizeof(*log));
+        log->magic = _MAGIC;
+        log->boots = 1;
+    }
+
+    memset(&log->boot, 0, sizeof(log->boot));
+    log->boot.task = POSTMORTEM_NO_TASK;
+    log->boot.stage = POSTMORTEM_STAGE_COUNT;
+}
+
+void postmortem_task(u8 index) {
+    if (_log) _log->boot.task = index;
+}
+
+void postmortem_stage(PostMortemStage stage, u32 now_us) {
+    if (!_log) return;
+
+    if (stage == POSTMORTEM_STAGE_READ) {
+        memset(&_frame, 0, sizeof(_frame));
+        _frame_us = now_us;
+    }
+    else if (_stage < POSTMORTEM_STAGE_COUNT) {
+        _frame.stage_us[_stage] = _clamp_u16(now_us - _stage_us);
+    }
+
+    _stage = stage;
+    _stage_us = now_us;
+    _log->boot.stage = stage;
+}
+
+void postmortem_frame_end(u32 frame, u32 now_us) {
+    if (!_log || _stage >= POSTMORTEM_STAGE_COUNT) return;
+
+    _frame.stage_us[_stage] = _clamp_u16(now_us - _stage_us);
+    _frame.frame = frame;
+    _frame.total_us = now_us - _frame_us;
+
+    PostMortemBoot *boot = &_log->boot;
+    _stage = POSTMORTEM_STAGE_COUNT;
+    boot->stage = POSTMORTEM_STAGE_COUNT;
+    boot->frame = frame;
+    if (_frame.total_us > FRAME_BUDGET_US) boot->overruns += 1;
+
+    // Almost every frame returns here
+    if (_frame.total_us <= boot->slowest[POSTMORTEM_SLOWEST - 1].total_us) return;
+
+    int i = POSTMORTEM_SLOWEST - 1;
+    for (; i > 0 && boot->slowest[i - 1].total_us < _frame.total_us; --i) boot->slowest[i] = boot->slowest[i - 1];
+    boot->slowest[i] = _frame;
+}
+
+void postmortem_plugin(bool running) {
+    if (_log) _log->boot.plugin = running;
+}
+
+void postmortem_inputs(u32 frame, InputMask inputs) {
+    if (!_log) return;
+
+    PostMortemBoot *boot = &_log->boot;
+    boot->inputs[boot->input_pos] = (PostMortemInput) { frame, inputs };
+    boot->input_pos = (boot->input_pos + 1) % POSTMORTEM_INPUTS;
+}
+
+const PostMortemLog *postmortem_previous(void) {
+    return _has_previous ? &_previous : NULL;
+}
+
+u16 postmortem_read(u8 block, u8 *buffer, u16 len) {
+    const PostMortemLog *log = (block & 0x80) ? _log : postmortem_previous();
+    if (!log) return 0;
+
+    u32 offset = (u32) (block & 0x7F) * POSTMORTEM_BLOCK_SIZE;
+    if (offset >= sizeof(*log)) return 0;
+
+    u16 size = POSTMORTEM_BLOCK_SIZE;
+    if (size > sizeof(*log) - offset) size = sizeof(*log) - offset;
+    if (size > len) return 0;
+
+    memcpy(buffer, (const u8 *) log + offset, size);
+    return size;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+// Post-mortem log of the scan loop. The backend keeps it in memory that survives a watchdog reset, so after a stall
+// the log of the boot that hung can still be read back over the vendor report.
+// Writing it costs a few stores per task and frame.
+
+#include "../common.h"
+#include "../settings.h"
+#include "platform.h"
+
+typedef enum {
+    POSTMORTEM_STAGE_READ,   // Reading the input sources
+    POSTMORTEM_STAGE_SCAN,   // Latching the sample, edge times and statistics
+    POSTMORTEM_STAGE_FRAME,  // User callback and report
+    POSTMORTEM_STAGE_COUNT,  // Between frames
+} PostMortemStage;
+
+#define POSTMORTEM_NO_TASK 0xFF
+
+// Bytes returned per postmortem_read block
+#define POSTMORTEM_BLOCK_SIZE 60
+
+typedef struct {
+    u32 frame;
+    u32 total_us;
+    u16 stage_us[POSTMORTEM_STAGE_COUNT];
+} PostMortemFrame;
+
+typedef struct {
+    u32 frame;
+    InputMask inputs;
+} PostMortemInput;
+
+// Everything about a single boot
+typedef struct {
+    // Scheduler task that ran last and, if that was the scan task, its stage. This is where a stalled boot hung.
+    u8 task;
+    u8 stage;
+    // Next slot of inputs, the oldest entry
+    u8 input_pos;
+    // Only set in the copy of the previous boot, true if it ended in a watchdog reset
+    u8 watchdog_reset;
+    // Set while a plugin task runs, a stall with it set is the plugin's fault
+    u8 plugin;
+    u8 reserved[3];
+
+    u32 frame;
+    // Frames over FRAME_BUDGET_US
+    u32 overruns;
+    // Slowest first
+    PostMortemFrame slowest[POSTMORTEM_SLOWEST];
+    // Last input changes
+    PostMortemInput inputs[POSTMORTEM_INPUTS];
+} PostMortemBoot;
+
+typedef struct {
+    u32 magic;
+    // Counted since the log was first created, which is the first power on
+    u32 boots;
+    u32 watchdog_resets;
+    PostMortemBoot boot;
+} PostMortemLog;
+
+// log lives in memory the backend doesn't clear on reset. Keeps a copy of the previous boot if log was valid.
+void postmortem_init(PostMortemLog *log, bool watchdog_reset);
+
+// Called by the scheduler before running a task
+void postmortem_task(u8 index);
+
+// Called by the scan task when a stage starts, POSTMORTEM_STAGE_READ starts a frame
+void postmortem_stage(PostMortemStage stage, u32 now_us);
+void postmortem_frame_end(u32 frame, u32 now_us);
+
+// Called around every plugin task
+void postmortem_plugin(bool running);
+
+// Called when the physical inputs change
+void postmortem_inputs(u32 frame, InputMask inputs);
+
+// Log with the previous boot, NULL if there is none
+const PostMortemLog *postmortem_previous(void);
+
+// Writes block number block & 0x7F of the previous log, or of the current one if bit 7 is set.
+// Returns the number of bytes written, 0 past the end or without a log.
+u16 postmortem_read(u8 block, u8 *buffer, u16 len);
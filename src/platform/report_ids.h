@@ -4,4 +4,5 @@ enum
 {
   REPORT_ID_KEYBOARD = 1,
   REPORT_ID_GAMEPAD = 2,
+  REPORT_ID_VENDOR = 3,
 };
@@ -0,0 +1,89 @@
+#include "scheduler.h"
+#include "device.h"
+#include "postmortem.h"
+
+static const SchedulerTask *_tasks = NULL;
+static u8 _count = 0;
+
+static u32 _release_us[SCHEDULER_MAX_TASKS] = {0};
+// Starts as the period of the task table, see scheduler_set_period
+static u32 _period_us[SCHEDULER_MAX_TASKS] = {0};
+static SchedulerTaskStats _stats[SCHEDULER_MAX_TASKS] = {0};
+
+void scheduler_init(const SchedulerTask *tasks, u8 count, u32 now_us) {
+    // Dropping the tasks past the limit would leave the box half working without a sign of why
+    if (count > SCHEDULER_MAX_TASKS) count = 0;
+
+    _tasks = tasks;
+    _count = count;
+
+    for (u8 i = 0; i < count; ++i) {
+        _release_us[i] = now_us;
+        _period_us[i] = tasks[i].period_us;
+    }
+}
+
+void scheduler_set_period(u8 index, u32 period_us) {
+    // A task can't switch between periodic and every pass
+    if (index >= _count || _period_us[index] == 0 || period_us == 0) return;
+    _period_us[index] = period_us;
+}
+
+// True if the higher priority tasks leave at least budget_us before one of them is released again
+static bool _fits_in_slack(u8 index, u32 budget_us, u32 now_us) {
+    for (u8 i = 0; i < index; ++i) {
+        if (_period_us[i] == 0) continue;
+        if ((i32)(_release_us[i] - now_us) < (i32) budget_us) return false;
+    }
+
+    return true;
+}
+
+u32 scheduler_run(void) {
+    for (u8 i = 0; i < _count; ++i) {
+        const SchedulerTask *task = &_tasks[i];
+        u32 now = backend_time_us();
+
+        if (_period_us[i] != 0) {
+            u32 late = now - _release_us[i];
+            if ((i32) late < 0) continue;
+            if (task->budget_us != 0 && !_fits_in_slack(i, task->budget_us, now)) continue;
+
+            if (late > _stats[i].max_late_us) _stats[i].max_late_us = late;
+            if (task->deadline_us != 0 && late > task->deadline_us) _stats[i].misses += 1;
+
+            // A task that fell more than a period behind drops the releases it missed instead of bursting
+            _release_us[i] += _period_us[i];
+            if ((i32)(now - _release_us[i]) >= 0) _release_us[i] = now + _period_us[i];
+        }
+        else if (task->budget_us != 0 && !_fits_in_slack(i, task->budget_us, now)) {
+            continue;
+        }
+
+        postmortem_task(i);
+        task->run();
+        _stats[i].runs += 1;
+    }
+
+    u32 now = backend_time_us();
+    u32 idle = 0xFFFFFFFF;
+    for (u8 i = 0; i < _count; ++i) {
+        if (_period_us[i] == 0) continue;
+
+        i32 until = (i32)(_release_us[i] - now);
+        if (until <= 0) return 0;
+        if ((u32) until < idle) idle = (u32) until;
+    }
+
+    return idle;
+}
+
+u16 scheduler_read_stats(u8 *buffer, u16 len) {
+    u8 count = _count;
+    if (len < 1) return 0;
+    if (count > (len - 1) / sizeof(SchedulerTaskStats)) count = (len - 1) / sizeof(SchedulerTaskStats);
+
+    buffer[0] = count;
+    memcpy(buffer + 1, _stats, count * sizeof(SchedulerTaskStats));
+    return 1 + count * sizeof(SchedulerTaskStats);
+}
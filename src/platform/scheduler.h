@@ -0,0 +1,39 @@
+#pragma once
+
+// Cooperative scheduler shared by the platform backends. Tasks are listed highest priority first and every pass
+// starts each due task in that order, so the scan task placed first always runs before anything else.
+
+#include "../common.h"
+#include "platform.h"
+
+#define SCHEDULER_MAX_TASKS 8
+
+typedef struct {
+    TaskCallback run;
+    // Time between releases, 0 runs the task on every pass
+    u32 period_us;
+    // A start later than this after the release counts as a deadline miss, 0 never misses
+    u32 deadline_us;
+    // Worst case run time. When set the task only starts if it can finish before the next release of a
+    // higher priority task, so it only ever uses slack time.
+    u32 budget_us;
+} SchedulerTask;
+
+typedef struct {
+    u32 runs;
+    u32 misses;
+    u32 max_late_us;
+} SchedulerTaskStats;
+
+// tasks must outlive the scheduler. All periodic tasks are first released at now_us. A table over
+// SCHEDULER_MAX_TASKS runs none of its tasks, so the backends check theirs with a _Static_assert.
+void scheduler_init(const SchedulerTask *tasks, u8 count, u32 now_us);
+
+// Changes the period of a periodic task from its next release on, the task table itself stays untouched
+void scheduler_set_period(u8 index, u32 period_us);
+
+// Runs one pass over the tasks. Returns the microseconds until the next periodic release.
+u32 scheduler_run(void);
+
+// Writes [count, SchedulerTaskStats * count]. Returns the number of bytes written.
+u16 scheduler_read_stats(u8 *buffer, u16 len);
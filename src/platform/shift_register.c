@@ -0,0 +1,53 @@
+#include <hardware/gpio.h>
+#include <hardware/structs/sio.h>
+#include <pico/stdlib.h>
+
+#include "../settings.h"
+#include "shift_register.h"
+
+#if SHIFT_REGISTER_INPUTS
+
+_Static_assert(SHIFT_REGISTER_INPUTS <= 32, "A shift register source provides at most 32 inputs");
+
+#define _LOAD_BIT (1u << SHIFT_REGISTER_LOAD_PIN)
+#define _CLOCK_BIT (1u << SHIFT_REGISTER_CLOCK_PIN)
+
+// The 74HC165 needs ~20ns pulses at 3.3V, a few cycles at 125MHz
+static inline void _settle(void) {
+    __asm volatile ("nop\nnop\nnop\n");
+}
+
+void shift_register_init(void) {
+    gpio_init(SHIFT_REGISTER_LOAD_PIN);
+    gpio_init(SHIFT_REGISTER_CLOCK_PIN);
+    gpio_init(SHIFT_REGISTER_DATA_PIN);
+
+    gpio_set_dir(SHIFT_REGISTER_LOAD_PIN, GPIO_OUT);
+    gpio_set_dir(SHIFT_REGISTER_CLOCK_PIN, GPIO_OUT);
+    gpio_put(SHIFT_REGISTER_LOAD_PIN, 1);
+    gpio_put(SHIFT_REGISTER_CLOCK_PIN, 0);
+}
+
+u32 shift_register_read(u32 *sample_us) {
+    // The parallel inputs are captured while load is low
+    *sample_us = time_us_32();
+    sio_hw->gpio_clr = _LOAD_BIT;
+    _settle();
+    sio_hw->gpio_set = _LOAD_BIT;
+    _settle();
+
+    // Buttons pull the register inputs low like they do the pins
+    u32 bits = 0;
+    for (int i = 0; i < SHIFT_REGISTER_INPUTS; ++i) {
+        bits |= (u32) !((sio_hw->gpio_in >> SHIFT_REGISTER_DATA_PIN) & 1) << i;
+
+        sio_hw->gpio_set = _CLOCK_BIT;
+        _settle();
+        sio_hw->gpio_clr = _CLOCK_BIT;
+        _settle();
+    }
+
+    return bits;
+}
+
+#endif
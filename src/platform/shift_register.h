@@ -0,0 +1,10 @@
+#pragma once
+
+#include "../common.h"
+
+// Chain of 74HC165 parallel in, serial out shift registers clocked out by hand. Takes about 40ns per input.
+// Only built when SHIFT_REGISTER_INPUTS is not 0.
+void shift_register_init(void);
+
+// Latches and shifts out the chain. Bit 0 is the first bit shifted out, input H of the register wired to the pico.
+u32 shift_register_read(u32 *sample_us);
@@ -0,0 +1,75 @@
+#include <hardware/flash.h>
+#include <hardware/sync.h>
+#include <pico/stdlib.h>
+
+#include "storage.h"
+
+#define _STORAGE_MAGIC 0x4F415453 // "OATS"
+
+typedef struct {
+    u32 magic;
+    u32 size;
+    u32 checksum;
+    u32 reserved;
+} _StorageHeader;
+
+static u8 _page[FLASH_PAGE_SIZE] __attribute__((aligned(4)));
+
+static u32 _offset(StorageSlot slot) {
+    return PICO_FLASH_SIZE_BYTES - (slot + 1) * FLASH_SECTOR_SIZE;
+}
+
+static u32 _checksum(const u8 *data, u32 size) {
+    // FNV-1a
+    u32 hash = 2166136261u;
+    for (u32 i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool storage_read(StorageSlot slot, void *data, u32 size) {
+    if (slot >= STORAGE_SLOT_COUNT) return false;
+
+    const u8 *sector = (const u8 *) (XIP_BASE + _offset(slot));
+    const _StorageHeader *header = (const _StorageHeader *) sector;
+
+    if (header->magic != _STORAGE_MAGIC || header->size != size) return false;
+    if (header->checksum != _checksum(sector + sizeof(_StorageHeader), size)) return false;
+
+    memcpy(data, sector + sizeof(_StorageHeader), size);
+    return true;
+}
+
+bool storage_write(StorageSlot slot, const void *data, u32 size) {
+    if (slot >= STORAGE_SLOT_COUNT) return false;
+    if (size > FLASH_SECTOR_SIZE - sizeof(_StorageHeader)) return false;
+
+    _StorageHeader header = {
+        .magic = _STORAGE_MAGIC,
+        .size = size,
+        .checksum = _checksum(data, size),
+    };
+
+    u32 offset = _offset(slot);
+    u32 total = sizeof(header) + size;
+
+    // Nothing can run from flash while it is being written, that includes the usb interrupt
+    u32 irq = save_and_disable_interrupts();
+    flash_range_erase(offset, FLASH_SECTOR_SIZE);
+
+    for (u32 written = 0; written < total; written += FLASH_PAGE_SIZE) {
+        memset(_page, 0xFF, sizeof(_page));
+
+        for (u32 i = 0; i < FLASH_PAGE_SIZE && written + i < total; ++i) {
+            u32 at = written + i;
+            _page[i] = at < sizeof(header) ? ((const u8 *) &header)[at] : ((const u8 *) data)[at - sizeof(header)];
+        }
+
+        flash_range_program(offset + written, _page, FLASH_PAGE_SIZE);
+    }
+
+    restore_interrupts(irq);
+    return true;
+}
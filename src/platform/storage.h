@@ -0,0 +1,19 @@
+#pragma once
+
+#include "../common.h"
+
+// Each slot is a flash sector counted back from the end of flash
+typedef enum {
+    STORAGE_SLOT_STATS,
+    STORAGE_SLOT_PLUGIN,
+
+    STORAGE_SLOT_COUNT,
+} StorageSlot;
+
+// Copies a previously written blob into data. Returns false if the slot is empty or was written with a different size.
+bool storage_read(StorageSlot slot, void *data, u32 size);
+
+// Erases the slot and writes the blob. This stalls flash (and everything running from it) for tens of milliseconds
+// with interrupts off, so only call it from a scheduler task when no input is held. Never from a usb callback, the
+// request would stall with it.
+bool storage_write(StorageSlot slot, const void *data, u32 size);
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "../common.h"
+
+// Sets bInterval of the hid IN endpoint in the configuration descriptor. Hosts only read it when they enumerate the
+// device, see platform_set_polling.
+void usb_descriptors_set_interval(u8 ms);
@@ -0,0 +1,192 @@
+#include <stddef.h>
+
+#include "plugin.h"
+#include "plugin_abi.h"
+#include "settings.h"
+#include "platform/device.h"
+#include "platform/postmortem.h"
+#include "platform/storage.h"
+
+_Static_assert(PLUGIN_MAX_SIZE % 4 == 0, "The slot is copied and stored in words");
+#if defined(__ARM_ARCH_6M__)
+_Static_assert(offsetof(Profile, state) == PLUGIN_PROFILE_STATE_OFFSET, "Profile.state moved, bump PLUGIN_ABI_VERSION");
+#endif
+
+// Where the plugin runs from, also the staging buffer of an upload
+static _Alignas(8) u8 _slot[PLUGIN_MAX_SIZE];
+static u32 _upload_size = 0;
+
+static PluginStatus _status = {0};
+static PluginTask _task = NULL;
+// Task of a committed upload that plugin_task still has to save, it starts running once the slot is in flash
+static PluginTask _unsaved = NULL;
+// Changes with every load so the profile state of the plugin before isn't reused
+static u32 _generation = 0;
+
+static const PluginApi _api = {
+    .abi_version = PLUGIN_ABI_VERSION,
+
+    .button_mask = button_mask,
+    .button_down = button_down,
+    .button_up = button_up,
+    .button_pressed = button_pressed,
+    .button_released = button_released,
+    .board_button_down = board_button_down,
+
+    .time_us = platform_time_us,
+    .frame = platform_frame,
+    .report_tick = platform_report_tick,
+    .request_update = platform_request_update,
+
+    .press = press,
+    .release = release,
+    .toggle = toggle,
+    .bind = bind,
+    .bind_pins = bind_pins,
+    .turbo = turbo,
+    .direction = virtual_direction,
+};
+
+static PluginState _check(const u8 *image, u32 size) {
+    switch (plugin_check_image(image, size, PLUGIN_MAX_SIZE, PLUGIN_ARCH_NATIVE)) {
+        case PLUGIN_IMAGE_OK:          return PLUGIN_READY;
+        case PLUGIN_IMAGE_UNSUPPORTED: return PLUGIN_UNSUPPORTED;
+        default:                       return PLUGIN_INVALID;
+    }
+}
+
+// Takes the image in the slot into use, or leaves the plugin off with the reason in the status
+static void _load(u32 size) {
+    const PluginHeader *header = (const PluginHeader *) _slot;
+
+    memset(&_status, 0, sizeof(_status));
+    _task = NULL;
+    _generation += 1;
+    if (size == 0) return;
+
+    _status.state = _check(_slot, size);
+    _status.size = size;
+    _status.checksum = header->checksum;
+    memcpy(_status.name, header->name, sizeof(_status.name) - 1);
+
+    // The entry offset keeps the thumb bit
+    if (_status.state == PLUGIN_READY) _task = (PluginTask) ((uintptr_t) _slot + header->entry);
+}
+
+static void _plugin_task(Profile *self) {
+    release_all();
+    if (_status.state != PLUGIN_READY || !_task) return;
+
+    PluginContext *context = plugin_context(self);
+    if (context->generation != _generation) {
+        const PluginHeader *header = (const PluginHeader *) _slot;
+
+        memset(context, 0, sizeof(*context));
+        context->api = &_api;
+        context->generation = _generation;
+        self->socd = header->socd;
+        self->mode = header->mode;
+    }
+
+    postmortem_plugin(true);
+    u32 start_us = backend_time_us();
+    u32 start = backend_cycles();
+
+    _task(self);
+
+    u32 cycles = (backend_cycles() - start) & BACKEND_CYCLES_MASK;
+    // The counter wraps every 134ms at 125MHz, a task anywhere near that slow saturates instead
+    if (backend_time_us() - start_us > 100000) cycles = BACKEND_CYCLES_MASK;
+    postmortem_plugin(false);
+
+    _status.runs += 1;
+    _status.last_cycles = cycles;
+    if (cycles > _status.max_cycles) _status.max_cycles = cycles;
+
+    if (cycles <= PLUGIN_BUDGET_CYCLES) {
+        _status.consecutive = 0;
+        return;
+    }
+
+    _status.overruns += 1;
+    _status.consecutive += 1;
+    if (_status.consecutive >= PLUGIN_MAX_OVERRUNS) {
+        _status.state = PLUGIN_OVERRUN;
+        _task = NULL;
+        release_all();
+    }
+}
+
+Profile create_plugin_profile(void) {
+    u32 size = 0;
+    if (storage_read(STORAGE_SLOT_PLUGIN, _slot, sizeof(_slot))) size = ((const PluginHeader *) _slot)->size;
+    _load(size);
+
+    // A plugin that stalled the scan loop would most likely stall it again, so it sits out a boot
+    const PostMortemLog *previous = postmortem_previous();
+    if (_status.state == PLUGIN_READY && previous && previous->boot.watchdog_reset && previous->boot.plugin) {
+        _status.state = PLUGIN_HUNG;
+        _task = NULL;
+    }
+
+    return (Profile) {
+        .task = _plugin_task,
+        .socd = SOCD_NEUTRAL,
+        .mode = MODE_KEYBOARD,
+        .keymap = NULL,
+        .state_size = sizeof(PluginContext),
+        // The context notices a new plugin by itself, and the plugin state survives profile switches
+        .state_policy = PROFILE_STATE_PRESERVE,
+    };
+}
+
+bool plugin_upload_begin(u32 size) {
+    if (size < sizeof(PluginHeader) || size > PLUGIN_MAX_SIZE) return false;
+
+    memset(&_status, 0, sizeof(_status));
+    _status.state = PLUGIN_UPLOADING;
+    _status.size = size;
+    _task = NULL;
+    _unsaved = NULL;
+
+    _upload_size = size;
+    memset(_slot, 0, sizeof(_slot));
+    return true;
+}
+
+bool plugin_upload_data(u32 offset, const u8 *data, u16 len) {
+    if (_status.state != PLUGIN_UPLOADING) return false;
+    if (offset > _upload_size || len > _upload_size - offset) return false;
+
+    memcpy(_slot + offset, data, len);
+    return true;
+}
+
+bool plugin_upload_commit(void) {
+    if (_status.state != PLUGIN_UPLOADING) return false;
+
+    _load(_upload_size);
+    if (_status.state != PLUGIN_READY) return false;
+
+    // Commit comes from a usb callback, too early for the flash write that stalls the cpu
+    _unsaved = _task;
+    _task = NULL;
+    return true;
+}
+
+void plugin_task(void) {
+    if (!_unsaved) return;
+
+    // The rest of the slot is zero, the stored blob always has the same size. Saved before the plugin first runs,
+    // so it is still the image that was uploaded.
+    storage_write(STORAGE_SLOT_PLUGIN, _slot, sizeof(_slot));
+    _task = _unsaved;
+    _unsaved = NULL;
+}
+
+u16 plugin_read_status(u8 *buffer, u16 len) {
+    if (len < sizeof(_status)) return 0;
+
+    memcpy(buffer, &_status, sizeof(_status));
+    return sizeof(_status);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// Loader and runtime of native profile plugins, see plugin_abi.h for the format.
+// One plugin is stored in flash and copied into an SRAM slot at boot or upload. Its profile runs the plugin task
+// with a cycle budget and disables a plugin that overruns it, or that hung the previous boot.
+
+#include "common.h"
+#include "profile.h"
+
+typedef enum {
+    PLUGIN_EMPTY,       // Nothing stored
+    PLUGIN_UPLOADING,   // Between plugin_upload_begin and plugin_upload_commit
+    PLUGIN_READY,       // Runs while its profile is active
+    PLUGIN_INVALID,     // Bad header, size or checksum
+    PLUGIN_UNSUPPORTED, // Built for another abi version or cpu, always the case on the linux port
+    PLUGIN_OVERRUN,     // Disabled after PLUGIN_MAX_OVERRUNS frames in a row over PLUGIN_BUDGET_CYCLES
+    PLUGIN_HUNG,        // The previous boot was reset by the watchdog while the plugin ran, skipped this boot
+} PluginState;
+
+typedef struct {
+    u8 state;
+    // Frames in a row over the budget
+    u8 consecutive;
+    u16 reserved;
+    u32 size;
+    u32 checksum;
+    // Calls to the plugin task since it was loaded
+    u32 runs;
+    u32 last_cycles;
+    u32 max_cycles;
+    // Frames over PLUGIN_BUDGET_CYCLES
+    u32 overruns;
+    char name[16];
+} PluginStatus;
+
+// Loads the stored plugin. The profile is valid without a plugin, it just doesn't press anything.
+Profile create_plugin_profile(void);
+
+// Uploads replace the plugin in place, it stops running at begin and the new one starts at a successful commit.
+// Chunks can come in any order. Commit checks and loads the image, plugin_task saves it to flash and starts it.
+bool plugin_upload_begin(u32 size);
+bool plugin_upload_data(u32 offset, const u8 *data, u16 len);
+bool plugin_upload_commit(void);
+// Saves a committed upload, called from the scheduler since usb callbacks must not write the flash
+void plugin_task(void);
+
+u16 plugin_read_status(u8 *buffer, u16 len);
@@ -0,0 +1,160 @@
+#pragma once
+
+// Binary interface between the firmware and native profile plugins, shared by both sides (see plugins/).
+//
+// A plugin is a position independent blob of cortex-m0+ code that starts with a PluginHeader. The firmware copies
+// it into an SRAM slot and calls its task wherever a Profile.task would run. Plugins don't link against the
+// firmware, everything they can do goes through the PluginApi table in their context, and they have no writable
+// globals: their state lives in PluginContext.state, which is zeroed whenever a new plugin is loaded.
+
+#include <stddef.h>
+
+#include "common.h"
+#include "profile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// "OPLG"
+#define PLUGIN_MAGIC 0x4F504C47u
+// Bumped whenever the header, the context or the api table change
+#define PLUGIN_ABI_VERSION 1
+
+// Bytes of state a plugin can use
+#define PLUGIN_STATE_SIZE 256
+
+typedef enum {
+    PLUGIN_ARCH_NONE,
+    PLUGIN_ARCH_ARMV6M,
+} PluginArch;
+
+#if defined(__ARM_ARCH_6M__)
+#define PLUGIN_ARCH_NATIVE PLUGIN_ARCH_ARMV6M
+#else
+#define PLUGIN_ARCH_NATIVE PLUGIN_ARCH_NONE
+#endif
+
+typedef void (*PluginTask)(Profile *self);
+
+// At offset 0 of the image. Only fixed size fields so the host tools can read it too.
+typedef struct {
+    u32 magic;
+    u16 abi_version;
+    u16 header_size;
+    // Whole image including the header, filled in by tools/plugin_upload
+    u32 size;
+    // FNV-1a of the image with this field zeroed, filled in by tools/plugin_upload
+    u32 checksum;
+    // Offset of the task from the start of the image, thumb bit included. Plugins are linked at 0 so this is
+    // simply the address of the task.
+    u32 entry;
+    // Bytes of PluginContext.state the plugin uses
+    u16 state_size;
+    // SocdType and InputMode the profile starts with
+    u8 socd;
+    u8 mode;
+    u8 arch;
+    u8 reserved[3];
+    char name[16];
+} PluginHeader;
+
+// Everything a plugin can call. Same functions as platform.h and virtual_button.h.
+typedef struct {
+    u32 abi_version;
+
+    InputMask (*button_mask)(void);
+    bool (*button_down)(int index);
+    bool (*button_up)(int index);
+    bool (*button_pressed)(int index);
+    bool (*button_released)(int index);
+    bool (*board_button_down)(void);
+
+    u32 (*time_us)(void);
+    u32 (*frame)(void);
+    u32 (*report_tick)(void);
+    void (*request_update)(void);
+
+    void (*press)(VirtualButton button);
+    void (*release)(VirtualButton button);
+    void (*toggle)(VirtualButton button);
+    void (*bind)(int index, VirtualButton button);
+    void (*bind_pins)(InputMask pins, VirtualButton button);
+    bool (*turbo)(u64 buttons, u8 on_ticks, u8 off_ticks);
+    u8 (*direction)(SocdType socd);
+} PluginApi;
+
+// The state block of the plugin profile. The virtual buttons are released before every call, like with the
+// profile builder the task declares everything that is pressed each frame.
+typedef struct {
+    const PluginApi *api;
+    // Private to the firmware, changes when a new plugin is loaded
+    u32 generation;
+    _Alignas(8) u8 state[PLUGIN_STATE_SIZE];
+} PluginContext;
+
+static inline PluginContext *plugin_context(Profile *self) {
+    return (PluginContext *) self->state;
+}
+
+// Where Profile.state is on armv6m. Plugins read it through plugin_context, so moving it changes the abi.
+#define PLUGIN_PROFILE_STATE_OFFSET 36
+
+// Why the firmware would refuse an image
+typedef enum {
+    PLUGIN_IMAGE_OK,
+    PLUGIN_IMAGE_INVALID,     // Bad header, size, checksum or entry
+    PLUGIN_IMAGE_UNSUPPORTED, // Built for another abi version or cpu
+} PluginImageCheck;
+
+// FNV-1a of an image with the checksum field read as zero, what PluginHeader.checksum holds
+static inline u32 plugin_checksum(const u8 *image, u32 size) {
+    u32 hash = 2166136261u;
+    for (u32 i = 0; i < size; ++i) {
+        bool field = i >= offsetof(PluginHeader, checksum) && i < offsetof(PluginHeader, checksum) + sizeof(u32);
+        hash ^= field ? 0 : image[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// The checks the firmware makes before it runs an image on arch from a slot of max_size bytes
+static inline PluginImageCheck plugin_check_image(const u8 *image, u32 size, u32 max_size, u8 arch) {
+    const PluginHeader *header = (const PluginHeader *) image;
+
+    if (size < sizeof(PluginHeader) || size > max_size) return PLUGIN_IMAGE_INVALID;
+    if (header->magic != PLUGIN_MAGIC || header->size != size) return PLUGIN_IMAGE_INVALID;
+    if (header->checksum != plugin_checksum(image, size)) return PLUGIN_IMAGE_INVALID;
+
+    if (header->abi_version != PLUGIN_ABI_VERSION || header->header_size != sizeof(PluginHeader)) {
+        return PLUGIN_IMAGE_UNSUPPORTED;
+    }
+    if (header->arch == PLUGIN_ARCH_NONE || header->arch != arch) return PLUGIN_IMAGE_UNSUPPORTED;
+
+    u32 entry = header->entry & ~1u;
+    if (entry < sizeof(PluginHeader) || entry >= size) return PLUGIN_IMAGE_INVALID;
+    if (header->state_size > PLUGIN_STATE_SIZE) return PLUGIN_IMAGE_INVALID;
+
+    return PLUGIN_IMAGE_OK;
+}
+
+// Declares the header of a plugin, once per plugin:
+//     PLUGIN("my plugin", _task, SOCD_NEUTRAL, MODE_GAMEPAD, sizeof(MyState));
+#define PLUGIN(_name, _task, _socd, _mode, _state_size)                 \
+    __attribute__((section(".plugin_header"), used))                    \
+    const PluginHeader plugin_header = {                                \
+        .magic = PLUGIN_MAGIC,                                          \
+        .abi_version = PLUGIN_ABI_VERSION,                              \
+        .header_size = sizeof(PluginHeader),                            \
+        .entry = (u32) (_task),                                         \
+        .state_size = (_state_size),                                    \
+        .socd = (_socd),                                                \
+        .mode = (_mode),                                                \
+        .arch = PLUGIN_ARCH_NATIVE,                                     \
+        .name = _name,                                                  \
+    };                                                                  \
+    _Static_assert((_state_size) <= PLUGIN_STATE_SIZE, "Plugin state doesn't fit in PLUGIN_STATE_SIZE")
+
+#ifdef __cplusplus
+}
+#endif
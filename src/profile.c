@@ -5,15 +5,39 @@ static Profile profiles[MAX_PROFILES] = {0};
 static int profile_count = 0;
 static int active_profile = INVALID_ID;
 
+// State blocks are handed out in registration order and never freed
+static _Alignas(PROFILE_STATE_ALIGN) u8 _arena[PROFILE_ARENA_SIZE];
+static u32 _arena_used = 0;
+
 int register_profile(Profile profile) {
     if (profile_count >= MAX_PROFILES) return INVALID_ID;
+
+    profile.state = NULL;
+    if (profile.state_size > 0) {
+        u32 size = (profile.state_size + PROFILE_STATE_ALIGN - 1) & ~(u32)(PROFILE_STATE_ALIGN - 1);
+        if (size > PROFILE_ARENA_SIZE - _arena_used) return INVALID_ID;
+
+        profile.state = &_arena[_arena_used];
+        memset(profile.state, 0, profile.state_size);
+        _arena_used += size;
+    }
+
     profiles[profile_count++] = profile;
     return profile_count - 1;
 }
 
 void select_profile(int id) {
     if (id >= profile_count || id < 0) return;
+
+    Profile *profile = &profiles[id];
+    if (id != active_profile && profile->state_policy == PROFILE_STATE_RESET && profile->state) {
+        memset(profile->state, 0, profile->state_size);
+    }
+
     active_profile = id;
+
+    // The new profile may map the buttons that are already down differently
+    platform_request_update();
 }
 
 Profile *get_active_profile(void) {
@@ -3,17 +3,48 @@
 #include "platform/platform.h"
 #include "virtual_button.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define INVALID_ID -1
 
+// What happens to a profile's state block when it is selected
+typedef enum {
+    PROFILE_STATE_RESET,    // Zeroed every time the profile becomes active
+    PROFILE_STATE_PRESERVE, // Kept across profile switches, only zeroed when registered
+} ProfileStatePolicy;
+
 typedef struct Profile {
     void (*task)(struct Profile *self);
 
     SocdType socd;
     InputMode mode;
+    // Report interval in milliseconds (1, 2, 4 or 8), 0 uses POLLING_RATE. See platform_set_polling.
+    u8 polling_ms;
+
+    // Keyboard key of each virtual button, NULL uses the defaults
+    const KeyCode *keymap;
+
+    // Applied to the inputs on every scan while the profile is active, NULL for none. See platform_set_input_filter.
+    InputFilter filter;
+    // Builds the report after task, NULL uses send_inputs with socd and keymap. See pipeline.hpp.
+    void (*send)(struct Profile *self);
+
+    // Size of the state block to reserve from the profile arena, 0 for stateless profiles.
+    // state is assigned by register_profile and stays valid for the lifetime of the firmware.
+    u16 state_size;
+    ProfileStatePolicy state_policy;
+    void *state;
 } Profile;
 
-// Registers a profile and returns its id (from 0 to MAX_PROFILES - 1). Returns INVALID_ID on error.
+// Registers a profile and returns its id (from 0 to MAX_PROFILES - 1).
+// Returns INVALID_ID when MAX_PROFILES is reached or the state block doesn't fit in PROFILE_ARENA_SIZE.
 // The profile is coppied into an internal buffer no need to preserve it outside.
 int register_profile(Profile profile);
 void select_profile(int id);
 Profile *get_active_profile(void);
+
+#ifdef __cplusplus
+}
+#endif
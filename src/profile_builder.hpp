@@ -0,0 +1,463 @@
+#pragma once
+
+// Compile time profile definitions. A profile is written as a constexpr chain of bindings and settings which the
+// compiler folds into lookup tables. Bad bindings fail the build, and the per-frame task only tests masks.
+//
+//     static constexpr ProfileDefinition _definition = ProfileDefinition()
+//         .socd(SOCD_NEUTRAL)
+//         .mode(MODE_KEYBOARD)
+//         .polling(2)
+//         .bind(1, LEFT)
+//         .bind(12, UP)
+//         .key(ATTACK_1, KEY_U)
+//         .state<MyState>(PROFILE_STATE_RESET)
+//         .task(my_task)
+//         .turbo(ATTACK_2, 2, 1)
+//         .motion("236", MACRO_1)
+//         .charge("46", 750, MACRO_2)
+//         .momentary_layer(16, 1)
+//         .layer(1)
+//         .bind(1, MACRO_1);
+//
+//     Profile create_my_profile(void) { return make_profile<_definition>(); }
+//
+// Bindings go to the layer selected with layer(), the base layer 0 by default. Layers are switched with physical
+// keys: momentary while held, toggle on press, or one shot for the next press. Pins a layer doesn't bind are
+// transparent and fall through to the next active layer below. A held pin keeps the binding it was pressed with
+// until it is released, so layer changes never release or press anything by themselves.
+//
+// Motions are recognised on the directions after socd resolution and tap their button for MOTION_PRESS_TICKS,
+// see motion.h for the matching rules.
+
+#include "motion.h"
+#include "pipeline.hpp"
+#include "profile.h"
+#include "settings.h"
+
+static_assert(VIRTUAL_BUTTON_COUNT <= 64, "Virtual buttons are stored in a 64 bit mask");
+static_assert(PROFILE_MAX_LAYERS <= 8, "Active layers are stored in an 8 bit mask");
+
+// These are deliberately not constexpr. Reaching one while evaluating a definition stops the build
+// and the compiler names the function in the error.
+inline void profile_error_pin_out_of_range() {}
+inline void profile_error_button_out_of_range() {}
+inline void profile_error_pin_bound_twice() {}
+inline void profile_error_key_out_of_range() {}
+inline void profile_error_state_too_large() {}
+inline void profile_error_state_misaligned() {}
+inline void profile_error_layer_out_of_range() {}
+inline void profile_error_turbo_pattern_invalid() {}
+inline void profile_error_too_many_turbo_patterns() {}
+inline void profile_error_motion_invalid() {}
+inline void profile_error_too_many_motions() {}
+inline void profile_error_too_many_motion_states() {}
+inline void profile_error_polling_rate_invalid() {}
+
+struct ProfileLayer {
+    // Physical pins driving each virtual button
+    InputMask pins[VIRTUAL_BUTTON_COUNT] = {};
+    // Virtual buttons that have at least one pin
+    u64 used = 0;
+    // Pins that are bound to something, including layer keys. Everything else is transparent.
+    InputMask bound = 0;
+
+    // Pins that switch layers and the layer each of them targets
+    InputMask layer_keys = 0;
+    InputMask momentary = 0;
+    InputMask toggle = 0;
+    InputMask one_shot = 0;
+    u8 target[INPUT_COUNT] = {};
+};
+
+// Lives in the profile state block after the user state
+struct ProfileLayerState {
+    // Pins down on the last evaluated frame
+    InputMask down;
+    // Held pins, grouped by the layer that resolved them when they were pressed
+    InputMask latched[PROFILE_MAX_LAYERS];
+
+    // Active layer masks, the base layer is always active
+    u8 held;
+    u8 toggled;
+    u8 one_shot;
+};
+
+struct ProfileTurbo {
+    u64 buttons = 0;
+    u8 on = 0;
+    u8 off = 0;
+};
+
+// Lives in the profile state block after the layer state
+struct ProfileMotionState {
+    MotionState recognizer;
+    // Motions whose button is still being tapped and the tick they matched on
+    u8 firing;
+    u32 matched[MOTION_MAX_PATTERNS];
+};
+
+struct ProfileDefinition {
+    ProfileLayer layers[PROFILE_MAX_LAYERS] = {};
+    int layer_count = 1;
+    // Layer that bind and the layer keys are added to
+    int current_layer = 0;
+
+    KeyCode keymap[VIRTUAL_BUTTON_COUNT] = {};
+    SocdType socd_type = SOCD_NEUTRAL;
+    InputMode input_mode = MODE_KEYBOARD;
+    u8 polling_ms = 0;
+
+    u16 state_size = 0;
+    ProfileStatePolicy state_policy = PROFILE_STATE_RESET;
+    // Runs after the bindings, every frame the profile is evaluated
+    void (*extra_task)(Profile *self) = nullptr;
+
+    ProfileTurbo turbos[TURBO_PATTERNS] = {};
+    int turbo_count = 0;
+
+    MotionPattern motions[MOTION_MAX_PATTERNS] = {};
+    VirtualButton motion_buttons[MOTION_MAX_PATTERNS] = {};
+    int motion_count = 0;
+
+    constexpr ProfileDefinition bind(int pin, VirtualButton button) const {
+        if (pin < 0 || pin >= INPUT_COUNT) profile_error_pin_out_of_range();
+        if (button < 0 || button >= VIRTUAL_BUTTON_COUNT) profile_error_button_out_of_range();
+        if (layers[current_layer].bound & INPUT_BIT(pin)) profile_error_pin_bound_twice();
+
+        ProfileDefinition result = *this;
+        ProfileLayer &layer = result.layers[current_layer];
+        layer.pins[button] |= INPUT_BIT(pin);
+        layer.used |= (u64) 1 << button;
+        layer.bound |= INPUT_BIT(pin);
+        return result;
+    }
+
+    // Following bindings and layer keys go to this layer
+    constexpr ProfileDefinition layer(int index) const {
+        if (index < 0 || index >= PROFILE_MAX_LAYERS) profile_error_layer_out_of_range();
+
+        ProfileDefinition result = *this;
+        result.current_layer = index;
+        if (index >= result.layer_count) result.layer_count = index + 1;
+        return result;
+    }
+
+    // Layer is active while the pin is held
+    constexpr ProfileDefinition momentary_layer(int pin, int target) const {
+        ProfileDefinition result = _layer_key(pin, target);
+        result.layers[current_layer].momentary |= INPUT_BIT(pin);
+        return result;
+    }
+
+    // Each press flips the layer on or off
+    constexpr ProfileDefinition toggle_layer(int pin, int target) const {
+        ProfileDefinition result = _layer_key(pin, target);
+        result.layers[current_layer].toggle |= INPUT_BIT(pin);
+        return result;
+    }
+
+    // Layer is active for the next press of any other pin
+    constexpr ProfileDefinition one_shot_layer(int pin, int target) const {
+        ProfileDefinition result = _layer_key(pin, target);
+        result.layers[current_layer].one_shot |= INPUT_BIT(pin);
+        return result;
+    }
+
+    constexpr ProfileDefinition key(VirtualButton button, KeyCode key) const {
+        if (button < 0 || button >= VIRTUAL_BUTTON_COUNT) profile_error_button_out_of_range();
+
+        // Same range keyboard_press accepts
+        bool valid = (key >= KEY_A && key <= KEY_KEYPAD_DECIMAL) || (key >= KEY_CONTROL_LEFT && key <= KEY_GUI_RIGHT);
+        if (!valid) profile_error_key_out_of_range();
+
+        ProfileDefinition result = *this;
+        result.keymap[button] = key;
+        return result;
+    }
+
+    constexpr ProfileDefinition socd(SocdType type) const {
+        ProfileDefinition result = *this;
+        result.socd_type = type;
+        return result;
+    }
+
+    constexpr ProfileDefinition mode(InputMode mode) const {
+        ProfileDefinition result = *this;
+        result.input_mode = mode;
+        return result;
+    }
+
+    // Report interval in milliseconds, see platform_set_polling. Without it the profile uses POLLING_RATE.
+    constexpr ProfileDefinition polling(int ms) const {
+        if (ms != 1 && ms != 2 && ms != 4 && ms != 8) profile_error_polling_rate_invalid();
+
+        ProfileDefinition result = *this;
+        result.polling_ms = (u8) ms;
+        return result;
+    }
+
+    // Reserves a State block in the profile arena, read it back with profile_state<State>(self)
+    template <typename State>
+    constexpr ProfileDefinition state(ProfileStatePolicy policy) const {
+        if (sizeof(State) > PROFILE_ARENA_SIZE) profile_error_state_too_large();
+        if (alignof(State) > PROFILE_STATE_ALIGN) profile_error_state_misaligned();
+
+        ProfileDefinition result = *this;
+        result.state_size = sizeof(State);
+        result.state_policy = policy;
+        return result;
+    }
+
+    // Pressed for on and released for off usb frames while held, see turbo() in virtual_button.h
+    constexpr ProfileDefinition turbo(VirtualButton button, u8 on, u8 off) const {
+        if (button < 0 || button >= VIRTUAL_BUTTON_COUNT) profile_error_button_out_of_range();
+        if (on == 0 || off == 0) profile_error_turbo_pattern_invalid();
+
+        ProfileDefinition result = *this;
+        for (int i = 0; i < result.turbo_count; ++i) {
+            if (result.turbos[i].on == on && result.turbos[i].off == off) {
+                result.turbos[i].buttons |= (u64) 1 << button;
+                return result;
+            }
+        }
+
+        if (result.turbo_count == TURBO_PATTERNS) profile_error_too_many_turbo_patterns();
+        result.turbos[result.turbo_count++] = ProfileTurbo{(u64) 1 << button, on, off};
+        return result;
+    }
+
+    // Taps button when the directions are entered within window report ticks, 0 uses MOTION_WINDOW_TICKS
+    constexpr ProfileDefinition motion(const char *directions, VirtualButton button, u16 window = 0) const {
+        return _motion(directions, button, window, 0);
+    }
+
+    // Same, with the first direction held for charge report ticks before the rest
+    constexpr ProfileDefinition charge(const char *directions, u16 charge, VirtualButton button, u16 window = 0) const {
+        if (charge == 0 || directions == nullptr || directions[0] == 0 || directions[0] == '5' || directions[1] == 0) {
+            profile_error_motion_invalid();
+        }
+        return _motion(directions, button, window, charge);
+    }
+
+    constexpr ProfileDefinition task(void (*task)(Profile *self)) const {
+        ProfileDefinition result = *this;
+        result.extra_task = task;
+        return result;
+    }
+
+    // The layer state follows the user state in the same block
+    constexpr u16 layer_state_offset() const {
+        return (state_size + alignof(ProfileLayerState) - 1) & ~(alignof(ProfileLayerState) - 1);
+    }
+
+    constexpr u16 motion_state_offset() const {
+        u16 end = layer_count > 1 ? layer_state_offset() + sizeof(ProfileLayerState) : state_size;
+        return (end + alignof(ProfileMotionState) - 1) & ~(alignof(ProfileMotionState) - 1);
+    }
+
+    // Size of the whole state block
+    constexpr u16 total_state_size() const {
+        if (motion_count > 0) return motion_state_offset() + sizeof(ProfileMotionState);
+        if (layer_count > 1) return layer_state_offset() + sizeof(ProfileLayerState);
+        return state_size;
+    }
+
+    constexpr ProfileDefinition _motion(const char *directions, VirtualButton button, u16 window, u16 charge) const {
+        if (button < 0 || button >= VIRTUAL_BUTTON_COUNT) profile_error_button_out_of_range();
+        if (directions == nullptr) profile_error_motion_invalid();
+
+        int length = 0;
+        for (; directions[length] != 0; ++length) {
+            if (directions[length] < '1' || directions[length] > '9') profile_error_motion_invalid();
+        }
+        if (length == 0 || length > MOTION_MAX_LENGTH) profile_error_motion_invalid();
+        if (motion_count == MOTION_MAX_PATTERNS) profile_error_too_many_motions();
+
+        ProfileDefinition result = *this;
+        result.motions[result.motion_count] = MotionPattern{directions, window, charge};
+        result.motion_buttons[result.motion_count] = button;
+        result.motion_count += 1;
+        return result;
+    }
+
+    constexpr ProfileDefinition _layer_key(int pin, int target) const {
+        if (pin < 0 || pin >= INPUT_COUNT) profile_error_pin_out_of_range();
+        if (target < 1 || target >= PROFILE_MAX_LAYERS) profile_error_layer_out_of_range();
+        if (layers[current_layer].bound & INPUT_BIT(pin)) profile_error_pin_bound_twice();
+
+        ProfileDefinition result = *this;
+        ProfileLayer &layer = result.layers[current_layer];
+        layer.bound |= INPUT_BIT(pin);
+        layer.layer_keys |= INPUT_BIT(pin);
+        layer.target[pin] = (u8) target;
+        if (target >= result.layer_count) result.layer_count = target + 1;
+        return result;
+    }
+};
+
+template <typename State>
+State *profile_state(Profile *profile) {
+    return static_cast<State *>(profile->state);
+}
+
+// Latches new presses to the top active layer that binds them and updates the layer masks
+template <const ProfileDefinition &definition>
+void profile_layer_update(ProfileLayerState *state, InputMask down) {
+    InputMask pressed = down & ~state->down;
+    InputMask released = state->down & ~down;
+    state->down = down;
+
+    if (released) {
+        for (int l = 0; l < definition.layer_count; ++l) state->latched[l] &= down;
+    }
+
+    if (pressed) {
+        // Presses resolve against the stack as it was before them
+        u8 active = 1 | state->held | state->toggled | state->one_shot;
+        u8 armed = 0;
+        bool consumed = false;
+
+        InputMask remaining = pressed;
+        for (int l = definition.layer_count - 1; l >= 0 && remaining; --l) {
+            if (!(active & (1u << l))) continue;
+
+            const ProfileLayer &layer = definition.layers[l];
+            InputMask mine = remaining & layer.bound;
+            remaining &= ~layer.bound;
+            state->latched[l] |= mine;
+
+            if (mine & ~layer.layer_keys) consumed = true;
+
+            for (InputMask keys = mine & (layer.toggle | layer.one_shot); keys; keys &= keys - 1) {
+                int pin = __builtin_ctzll(keys);
+                u8 bit = 1u << layer.target[pin];
+
+                if (layer.toggle & INPUT_BIT(pin)) state->toggled ^= bit;
+                else armed |= bit;
+            }
+        }
+
+        if (consumed) state->one_shot = 0;
+        state->one_shot |= armed;
+    }
+
+    if (pressed | released) {
+        // Momentary layers follow the keys that are still latched
+        u8 held = 0;
+        for (int l = 0; l < definition.layer_count; ++l) {
+            const ProfileLayer &layer = definition.layers[l];
+            for (InputMask keys = state->latched[l] & layer.momentary; keys; keys &= keys - 1) {
+                held |= 1u << layer.target[__builtin_ctzll(keys)];
+            }
+        }
+        state->held = held;
+    }
+}
+
+// The motion automaton of a definition. The patterns need more than MOTION_MAX_STATES states when this fails.
+template <const ProfileDefinition &definition>
+constexpr MotionTable profile_motion_table() {
+    MotionTable table = {};
+    if (!motion_build(&table, definition.motions, (u8) definition.motion_count)) profile_error_too_many_motion_states();
+    return table;
+}
+
+// Steps the motion automaton with this frame's direction and taps the buttons of the motions it recognised
+template <const ProfileDefinition &definition>
+void profile_motion_update(Profile *self) {
+    // Built by the compiler into a const table, the state block only holds the position in it
+    static constexpr MotionTable table = profile_motion_table<definition>();
+
+    auto *state = (ProfileMotionState *)((u8 *) self->state + definition.motion_state_offset());
+    u32 tick = platform_report_tick();
+
+    u8 matched = motion_step(&table, &state->recognizer, virtual_direction(self->socd), tick);
+    for (u8 bits = matched; bits; bits &= bits - 1) state->matched[__builtin_ctz(bits)] = tick;
+    state->firing |= matched;
+
+    for (u8 bits = state->firing; bits; bits &= bits - 1) {
+        int motion = __builtin_ctz(bits);
+        if (tick - state->matched[motion] >= MOTION_PRESS_TICKS) {
+            state->firing &= ~(1u << motion);
+            continue;
+        }
+
+        press(definition.motion_buttons[motion]);
+        // The tap ends on a later tick without any new input
+        platform_request_update();
+    }
+}
+
+template <const ProfileDefinition &definition>
+void profile_definition_task(Profile *self) {
+    release_all();
+
+    InputMask down = button_mask();
+
+    if constexpr (definition.layer_count == 1) {
+        const ProfileLayer &layer = definition.layers[0];
+        if (down & layer.bound) {
+            for (u64 used = layer.used; used; used &= used - 1) {
+                int button = __builtin_ctzll(used);
+                bind_pins(layer.pins[button] & down, (VirtualButton) button);
+            }
+        }
+    }
+    else {
+        auto *state = (ProfileLayerState *)((u8 *) self->state + definition.layer_state_offset());
+        profile_layer_update<definition>(state, down);
+
+        for (int l = 0; l < definition.layer_count; ++l) {
+            const ProfileLayer &layer = definition.layers[l];
+            InputMask pins = state->latched[l] & ~layer.layer_keys;
+            if (!pins) continue;
+
+            for (u64 used = layer.used; used; used &= used - 1) {
+                int button = __builtin_ctzll(used);
+                bind_pins(layer.pins[button] & pins, (VirtualButton) button);
+            }
+        }
+    }
+
+    if constexpr (definition.motion_count > 0) {
+        profile_motion_update<definition>(self);
+    }
+
+    for (int i = 0; i < definition.turbo_count; ++i) {
+        turbo(definition.turbos[i].buttons, definition.turbos[i].on, definition.turbos[i].off);
+    }
+
+    if constexpr (definition.extra_task != nullptr) definition.extra_task(self);
+}
+
+// Pipeline stage of a definition, see pipeline.hpp
+template <const ProfileDefinition &definition>
+struct ProfileMapping {
+    static constexpr PipelineStageKind kind = PIPELINE_MAPPING;
+    static constexpr u16 state_size = definition.total_state_size();
+
+    struct State {};
+
+    static void run(State &, PipelineFrame &frame) {
+        profile_definition_task<definition>(frame.profile);
+    }
+
+    static Profile profile() {
+        static_assert(definition.total_state_size() <= PROFILE_ARENA_SIZE, "Profile state doesn't fit in the profile arena");
+
+        Profile profile = {};
+        profile.socd = definition.socd_type;
+        profile.mode = definition.input_mode;
+        profile.polling_ms = definition.polling_ms;
+        profile.keymap = definition.keymap;
+        profile.state_size = definition.total_state_size();
+        profile.state_policy = definition.state_policy;
+
+        return profile;
+    }
+};
+
+template <const ProfileDefinition &definition>
+Profile make_profile() {
+    return make_pipeline_profile<Pipeline<ProfileMapping<definition>, Turbo, Socd, ReportEncoder>>();
+}
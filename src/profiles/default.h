@@ -2,4 +2,12 @@
 
 #include "../profile.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 Profile create_default_profile(void);
+
+#ifdef __cplusplus
+}
+#endif
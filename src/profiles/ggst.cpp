@@ -0,0 +1,42 @@
+#include "ggst.h"
+#include "../profile_builder.hpp"
+
+static constexpr ProfileDefinition _definition = ProfileDefinition()
+    .socd(SOCD_NEUTRAL)
+    .mode(MODE_KEYBOARD)
+
+    .bind(BUTTON_RING, LEFT)
+    .bind(BUTTON_MIDDLE, DOWN)
+    .bind(BUTTON_INDEX, RIGHT)
+    .bind(BUTTON_PINKY, UP)
+    .bind(BUTTON_LEFT_THUMB_1, UP)
+
+    .bind(BUTTON_TOP_1, ATTACK_1)
+    .bind(BUTTON_TOP_2, ATTACK_2)
+    .bind(BUTTON_TOP_3, ATTACK_3)
+    .bind(BUTTON_TOP_4, ATTACK_4)
+    .bind(BUTTON_BOTTOM_1, ATTACK_5)
+    .bind(BUTTON_BOTTOM_2, ATTACK_6)
+    .bind(BUTTON_BOTTOM_3, ATTACK_7)
+    .bind(BUTTON_BOTTOM_4, ATTACK_8)
+
+    .bind(BUTTON_LEFT_THUMB_2, MACRO_1)
+    .bind(BUTTON_RIGHT_THUMB_1, MACRO_2)
+    .bind(BUTTON_RIGHT_THUMB_2, MACRO_3)
+
+    .bind(BUTTON_HOME, UTILITY)
+
+    // You can't rebind these so they need dedicated buttons.
+    .bind(BUTTON_F1, SPECIAL_ENTER)
+    .bind(BUTTON_F2, SPECIAL_BACKSPACE)
+
+    .bind(BUTTON_F3, EXTRA_3)
+    .bind(BUTTON_F4, EXTRA_4)
+    .bind(BUTTON_F5, EXTRA_5)
+    .bind(BUTTON_F6, EXTRA_6)
+    .bind(BUTTON_F7, EXTRA_7)
+    .bind(BUTTON_F8, EXTRA_8);
+
+Profile create_ggst_profile(void) {
+    return make_profile<_definition>();
+}
@@ -3,5 +3,99 @@
 // Maximun number of profiles that can be stored
 #define MAX_PROFILES 8
 
-// Polling rate in milliseconds
+// Bytes shared by the state blocks of all registered profiles, and the alignment of each block
+#define PROFILE_ARENA_SIZE 1024
+#define PROFILE_STATE_ALIGN 8
+
+// Layers a profile definition can stack, including the base layer
+#define PROFILE_MAX_LAYERS 8
+
+// Different turbo on/off patterns that can run at the same time, any number of buttons can share one
+#define TURBO_PATTERNS 4
+
+// Motion inputs (236, 623, charge...) a profile can recognise, the longest motion and the automaton size
+#define MOTION_MAX_PATTERNS 8
+#define MOTION_MAX_LENGTH 8
+#define MOTION_MAX_STATES 48
+// Default leniency in report ticks, from the first direction of a motion to its last. 200 is 12 frames at 60 fps.
+#define MOTION_WINDOW_TICKS 200
+// Report ticks the button of a recognised motion stays pressed
+#define MOTION_PRESS_TICKS 20
+
+// Polling rate in milliseconds, profiles without one of their own use it. See platform_set_polling.
 #define POLLING_RATE 1
+// Disconnects the box and enumerates it again when the polling rate changes, so the host picks up the new bInterval.
+// The host sees the gamepad or keyboard unplugged for USB_REENUMERATE_MS plus its enumeration: held inputs are
+// released and games that don't handle hot plugging lose the controller. Off by default, turn it on with
+// -DCHEATBOX_USB_REENUMERATE=ON. Without it the host keeps the interval it enumerated with until the box is plugged
+// in again.
+#ifndef USB_REENUMERATE
+#define USB_REENUMERATE 0
+#endif
+// How long the box stays disconnected when it enumerates again, long enough for hubs to see it go away
+#define USB_REENUMERATE_MS 250
+
+// A scan that starts later than this after its slot counts as a deadline miss
+#define SCAN_DEADLINE_US 100
+
+// Rates of the background tasks, they only run in the slack time between scans
+#define BOOTSEL_SAMPLE_MS 20
+#define LED_UPDATE_MS 10
+#define STATS_TASK_MS 100
+
+// The hardware watchdog resets the box when the scheduler hasn't completed a pass for this long
+#define WATCHDOG_TIMEOUT_MS 1000
+
+// A frame that takes longer than this from reading the inputs to queuing the report is logged as an overrun.
+// The post-mortem log also keeps the slowest frames and the last input changes, see platform/postmortem.h.
+#define FRAME_BUDGET_US 500
+#define POSTMORTEM_SLOWEST 4
+#define POSTMORTEM_INPUTS 16
+
+// Largest plugin image, it has to fit in a flash sector with the storage header. See plugin_abi.h.
+#define PLUGIN_MAX_SIZE 4064
+// Cycles a plugin task may take per frame, 100us at 125MHz. A plugin over it for PLUGIN_MAX_OVERRUNS frames in a
+// row is disabled until the next upload or boot.
+#define PLUGIN_BUDGET_CYCLES 12500
+#define PLUGIN_MAX_OVERRUNS 3
+
+// A press that comes sooner than this after the previous release is counted as switch chatter
+#define STATS_CHATTER_US 2000
+// Window for profiles that add the Debounce pipeline stage, the same as what counts as chatter
+#define DEBOUNCE_US STATS_CHATTER_US
+
+// How often the button statistics are saved to flash. Saving only happens when no button is held.
+#define STATS_SAVE_INTERVAL_MS (10 * 60 * 1000)
+
+// Appends a vendor field with a report sequence number, the scan number and the edge to report latency
+// to the keyboard and gamepad reports. Used by tools/report_latency to measure latency on the host.
+// Off by default so the reports stay the plain size, turn it on with -DCHEATBOX_REPORT_TIMING=ON.
+#ifndef REPORT_TIMING
+#define REPORT_TIMING 0
+#endif
+#define REPORT_TIMING_NO_EDGE 0xFFFF
+
+// GPIO 26-28 that have hall effect sensors instead of switches, read through the adc. 0 keeps them all digital.
+// e.g. (1u << 26) | (1u << 27) for analog buttons on 26 and 27. Also set by -DCHEATBOX_ANALOG_PINS.
+#ifndef ANALOG_PINS
+#define ANALOG_PINS 0
+#endif
+// Readings averaged per pin and scan, the adc takes 2us per reading
+#define ANALOG_SAMPLES 8
+// Raw distance from rest to the bottom of the travel before calibration widens it, negative if the reading drops
+#define ANALOG_RANGE 1200
+// In 1/1024 of the key travel
+#define ANALOG_ACTUATION 400
+#define ANALOG_HYSTERESIS 40
+// Rapid trigger sensitivity, set ANALOG_RAPID_PRESS to 0 to disable it
+#define ANALOG_RAPID_PRESS 50
+#define ANALOG_RAPID_RELEASE 50
+
+// Inputs read from a chain of 74HC165 shift registers, numbered from 32. 0 disables the chain.
+// The three pins are taken away from the buttons when it is enabled. Also set by -DCHEATBOX_SHIFT_REGISTER_INPUTS.
+#ifndef SHIFT_REGISTER_INPUTS
+#define SHIFT_REGISTER_INPUTS 0
+#endif
+#define SHIFT_REGISTER_LOAD_PIN 20
+#define SHIFT_REGISTER_CLOCK_PIN 21
+#define SHIFT_REGISTER_DATA_PIN 22
@@ -0,0 +1,125 @@
+#include "stats.h"
+#include "settings.h"
+#include "temporal.h"
+#include "platform/platform.h"
+#include "platform/board.h"
+#include "platform/storage.h"
+
+// Bumped whenever stored counters would land on other inputs. Blobs without a version were indexed by gpio.
+#define STATS_VERSION 2
+
+typedef struct {
+    u32 version;
+    ButtonStats stats[INPUT_COUNT];
+} _SavedStats;
+
+static _SavedStats _saved = {.version = STATS_VERSION};
+static ButtonStats *const _stats = _saved.stats;
+static bool _dirty = false;
+static u32 _last_save_us = 0;
+// Set by stats_reset, which runs inside a usb request where the flash write can't
+static bool _reset_pending = false;
+
+// Moves counters saved by gpio onto the board's buttons. Gpio without a button lose theirs, expansion inputs kept
+// their numbers.
+static void _migrate_gpio_stats(void) {
+    ButtonStats by_gpio[32];
+    memcpy(by_gpio, _stats, sizeof(by_gpio));
+    memset(_stats, 0, sizeof(by_gpio));
+
+    for (u8 gpio = 0; gpio < 32; ++gpio) {
+        u8 button = board_button_of_gpio(gpio);
+        if (button != BOARD_NO_BUTTON) _stats[button] = by_gpio[gpio];
+    }
+
+    _dirty = true;
+}
+
+void stats_init(void) {
+    if (storage_read(STORAGE_SLOT_STATS, &_saved, sizeof(_saved)) && _saved.version == STATS_VERSION) return;
+
+    memset(&_saved, 0, sizeof(_saved));
+    _saved.version = STATS_VERSION;
+
+    // Saved by gpio, for all inputs or from before the state was widened for only the 32 pins
+    if (storage_read(STORAGE_SLOT_STATS, _stats, INPUT_COUNT * sizeof(ButtonStats))
+        || storage_read(STORAGE_SLOT_STATS, _stats, 32 * sizeof(ButtonStats))) {
+        _migrate_gpio_stats();
+        return;
+    }
+
+    // A failed read can leave part of a blob behind
+    memset(_stats, 0, INPUT_COUNT * sizeof(ButtonStats));
+}
+
+void stats_update(InputMask new_state, InputMask old_state) {
+    // Most scans have no edges at all, so this is the only work done on them
+    InputMask changed = new_state ^ old_state;
+    if (!changed) return;
+
+    _dirty = true;
+
+    while (changed) {
+        int pin = __builtin_ctzll(changed);
+        changed &= changed - 1;
+
+        const InputTiming *timing = pin_timing(pin);
+        ButtonStats *stats = &_stats[pin];
+
+        if (new_state & INPUT_BIT(pin)) {
+            stats->presses += 1;
+
+            if (timing->release_frame != 0 && timing->press_us - timing->release_us < STATS_CHATTER_US) {
+                stats->chatter += 1;
+            }
+        }
+        else if (timing->press_frame != 0) {
+            u32 held_us = timing->release_us - timing->press_us;
+
+            if (stats->shortest_press_us == 0 || held_us < stats->shortest_press_us) {
+                stats->shortest_press_us = held_us;
+            }
+
+            stats->total_hold_ms += (held_us + 500) / 1000;
+        }
+    }
+}
+
+void stats_task(void) {
+    if (_reset_pending) {
+        _reset_pending = false;
+        _last_save_us = platform_time_us();
+        storage_write(STORAGE_SLOT_STATS, &_saved, sizeof(_saved));
+        return;
+    }
+
+    if (!_dirty || has_input()) return;
+    if (platform_time_us() - _last_save_us < STATS_SAVE_INTERVAL_MS * 1000u) return;
+
+    _last_save_us = platform_time_us();
+    _dirty = false;
+    storage_write(STORAGE_SLOT_STATS, &_saved, sizeof(_saved));
+}
+
+void stats_reset(void) {
+    memset(_stats, 0, INPUT_COUNT * sizeof(ButtonStats));
+    _dirty = false;
+    _reset_pending = true;
+}
+
+const ButtonStats *button_stats(int index) {
+    if (index < 0 || index >= INPUT_COUNT) return NULL;
+    return &_stats[index];
+}
+
+u16 stats_read(u8 first_pin, u8 *buffer, u16 len) {
+    if (len < 1 || first_pin >= INPUT_COUNT) return 0;
+
+    u16 count = (len - 1) / sizeof(ButtonStats);
+    if (count > INPUT_COUNT - first_pin) count = INPUT_COUNT - first_pin;
+
+    buffer[0] = (u8) count;
+    memcpy(buffer + 1, &_stats[first_pin], count * sizeof(ButtonStats));
+
+    return 1 + count * sizeof(ButtonStats);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "common.h"
+#include "platform/platform.h"
+
+// Lifetime usage counters of a physical button. Persisted to flash every STATS_SAVE_INTERVAL_MS.
+typedef struct {
+    u32 presses;
+    // Presses that came less than STATS_CHATTER_US after the previous release, a sign of a worn switch
+    u32 chatter;
+    u32 shortest_press_us;
+    u32 total_hold_ms;
+} ButtonStats;
+
+void stats_init(void);
+
+// Called by the platform every scan after the temporal state was updated
+void stats_update(InputMask new_state, InputMask old_state);
+
+// Saves the counters to flash when they changed and no input is held, or right away after a reset
+void stats_task(void);
+// Zeroes the counters at once, the flash copy is cleared by the next stats_task
+void stats_reset(void);
+
+const ButtonStats *button_stats(int index);
+
+// Writes as many stats as fit into the buffer starting from first_pin. Returns the number of bytes written.
+u16 stats_read(u8 first_pin, u8 *buffer, u16 len);
@@ -0,0 +1,124 @@
+#include "temporal.h"
+#include "platform/platform.h"
+
+static InputTiming _pins[INPUT_COUNT] = {0};
+static InputTiming _buttons[VIRTUAL_BUTTON_COUNT] = {0};
+
+static InputMask _pins_down = 0;
+static u64 _buttons_down = 0;
+
+static inline i32 _order(const InputTiming *a, const InputTiming *b) {
+    // Wrapping difference, valid as long as both presses are less than ~35 minutes apart
+    i32 delta = (i32)(a->press_us - b->press_us);
+    if (delta == 0) return 0;
+    return delta > 0 ? 1 : -1;
+}
+
+// Both results can change without any new input, so keep frames evaluated until they settle
+
+static inline bool _held_for(const InputTiming *timing, bool down, u32 us) {
+    if (!down) return false;
+
+    bool held = platform_time_us() - timing->press_us >= us;
+    if (!held) platform_request_update();
+    return held;
+}
+
+static inline bool _tapped_within(const InputTiming *timing, bool down, u32 us) {
+    bool tapped = !down && timing->press_frame != 0 && platform_time_us() - timing->press_us <= us;
+    if (tapped) platform_request_update();
+    return tapped;
+}
+
+void temporal_pin_edges(InputMask new_state, InputMask old_state, const u32 *edge_us) {
+    InputMask changed = new_state ^ old_state;
+    u32 frame = platform_frame();
+
+    while (changed) {
+        int pin = __builtin_ctzll(changed);
+        changed &= changed - 1;
+
+        if (new_state & INPUT_BIT(pin)) {
+            _pins[pin].press_us = edge_us[pin];
+            _pins[pin].press_frame = frame;
+        }
+        else {
+            _pins[pin].release_us = edge_us[pin];
+            _pins[pin].release_frame = frame;
+        }
+    }
+
+    _pins_down = new_state;
+}
+
+void temporal_button_edges(u64 new_state, u64 old_state, const InputMask *sources) {
+    u64 changed = new_state ^ old_state;
+    u32 frame = platform_frame();
+    u32 now = platform_time_us();
+
+    while (changed) {
+        int button = __builtin_ctzll(changed);
+        changed &= changed - 1;
+
+        if (!(new_state & ((u64)1 << button))) {
+            _buttons[button].release_us = now;
+            _buttons[button].release_frame = frame;
+            continue;
+        }
+
+        // The virtual button went down when the first of its pins did
+        u32 press_us = now;
+        InputMask pins = sources[button] & _pins_down;
+        while (pins) {
+            int pin = __builtin_ctzll(pins);
+            pins &= pins - 1;
+
+            if (now - _pins[pin].press_us > now - press_us) press_us = _pins[pin].press_us;
+        }
+
+        _buttons[button].press_us = press_us;
+        _buttons[button].press_frame = frame;
+    }
+
+    _buttons_down = new_state;
+}
+
+const InputTiming *pin_timing(int index) {
+    if (index < 0 || index >= INPUT_COUNT) return NULL;
+    return &_pins[index];
+}
+
+const InputTiming *virtual_timing(VirtualButton button) {
+    if (button >= VIRTUAL_BUTTON_COUNT) return NULL;
+    return &_buttons[button];
+}
+
+i32 button_press_order(int a, int b) {
+    if (a < 0 || a >= INPUT_COUNT || b < 0 || b >= INPUT_COUNT) return 0;
+    return _order(&_pins[a], &_pins[b]);
+}
+
+i32 virtual_press_order(VirtualButton a, VirtualButton b) {
+    if (a >= VIRTUAL_BUTTON_COUNT || b >= VIRTUAL_BUTTON_COUNT) return 0;
+    return _order(&_buttons[a], &_buttons[b]);
+}
+
+bool button_held_for(int index, u32 us) {
+    if (index < 0 || index >= INPUT_COUNT) return false;
+    return _held_for(&_pins[index], _pins_down & INPUT_BIT(index), us);
+}
+
+bool virtual_held_for(VirtualButton button, u32 us) {
+    if (button >= VIRTUAL_BUTTON_COUNT) return false;
+    return _held_for(&_buttons[button], _buttons_down & ((u64)1 << button), us);
+}
+
+bool button_tapped_within(int index, u32 us) {
+    if (index < 0 || index >= INPUT_COUNT) return false;
+    return _tapped_within(&_pins[index], _pins_down & INPUT_BIT(index), us);
+}
+
+bool virtual_tapped_within(VirtualButton button, u32 us) {
+    if (button >= VIRTUAL_BUTTON_COUNT) return false;
+    return _tapped_within(&_buttons[button], _buttons_down & ((u64)1 << button), us);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "common.h"
+#include "virtual_button.h"
+#include "platform/platform.h"
+
+// Press and release history of a single input.
+// Times are in microseconds since boot and wrap every ~71 minutes, frames count scans since boot.
+// A frame of 0 means the edge never happened.
+typedef struct {
+    u32 press_us;
+    u32 release_us;
+    u32 press_frame;
+    u32 release_frame;
+} InputTiming;
+
+// Called by the platform every scan. edge_us holds the time of the first edge seen on each input since the last scan.
+void temporal_pin_edges(InputMask new_state, InputMask old_state, const u32 *edge_us);
+
+// Called by send_inputs every frame. sources holds the physical inputs that drive each virtual button.
+// A virtual press takes the time of the earliest source pin press, or the scan time if it has no sources.
+void temporal_button_edges(u64 new_state, u64 old_state, const InputMask *sources);
+
+const InputTiming *pin_timing(int index);
+const InputTiming *virtual_timing(VirtualButton button);
+
+// Returns > 0 if a was pressed after b, < 0 if b was pressed after a and 0 if they were pressed at the same time
+i32 button_press_order(int a, int b);
+i32 virtual_press_order(VirtualButton a, VirtualButton b);
+
+// True if the input is down and has been held for at least us microseconds
+bool button_held_for(int index, u32 us);
+bool virtual_held_for(VirtualButton button, u32 us);
+
+// True if the input was pressed and released again within the last us microseconds
+bool button_tapped_within(int index, u32 us);
+bool virtual_tapped_within(VirtualButton button, u32 us);
@@ -0,0 +1,65 @@
+#include "vendor.h"
+#include "plugin.h"
+#include "stats.h"
+#include "platform/platform.h"
+#include "platform/input_source.h"
+#include "platform/postmortem.h"
+#include "platform/scheduler.h"
+
+static u8 _command = VENDOR_CMD_NONE;
+static u8 _argument = 0;
+
+void vendor_set_report(const u8 *buffer, u16 len) {
+    if (len < 1) return;
+
+    _command = buffer[0];
+    _argument = len > 1 ? buffer[1] : 0;
+
+    // Commands without a response run immediately
+    switch (_command) {
+        case VENDOR_CMD_RESET_BUTTON_STATS: stats_reset(); break;
+
+        case VENDOR_CMD_PLUGIN_BEGIN:
+            if (len >= 6) plugin_upload_begin(buffer[2] | buffer[3] << 8 | buffer[4] << 16 | (u32) buffer[5] << 24);
+            break;
+
+        case VENDOR_CMD_PLUGIN_DATA:
+            if (len >= 4u + _argument) plugin_upload_data(buffer[2] | buffer[3] << 8, buffer + 4, _argument);
+            break;
+
+        case VENDOR_CMD_PLUGIN_COMMIT: plugin_upload_commit(); break;
+
+        case VENDOR_CMD_STRESS:
+            if (len >= 6) platform_stress(buffer[2] | buffer[3] << 8 | buffer[4] << 16 | (u32) buffer[5] << 24);
+            break;
+    }
+}
+
+u16 vendor_get_report(u8 *buffer, u16 len) {
+    if (len < 2) return 0;
+
+    buffer[0] = _command;
+    buffer[1] = _argument;
+
+    u8 *data = buffer + 2;
+    u16 size = len - 2;
+    u16 written = 0;
+
+    switch (_command) {
+        case VENDOR_CMD_BUTTON_STATS:    written = stats_read(_argument, data, size); break;
+        case VENDOR_CMD_BOOT_TIMES:      written = platform_read_boot_times(data, size); break;
+        case VENDOR_CMD_FRAME_STATS:     written = platform_read_frame_stats(data, size); break;
+        case VENDOR_CMD_SCHEDULER_STATS: written = scheduler_read_stats(data, size); break;
+        case VENDOR_CMD_INPUT_SOURCES:   written = input_sources_read_stats(data, size); break;
+        case VENDOR_CMD_POSTMORTEM:      written = postmortem_read(_argument, data, size); break;
+
+        case VENDOR_CMD_PLUGIN_BEGIN:
+        case VENDOR_CMD_PLUGIN_DATA:
+        case VENDOR_CMD_PLUGIN_COMMIT:
+        case VENDOR_CMD_PLUGIN_STATUS:   written = plugin_read_status(data, size); break;
+
+        case VENDOR_CMD_STRESS:          written = platform_read_stress(data, size); break;
+    }
+
+    return 2 + written;
+}
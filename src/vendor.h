@@ -0,0 +1,42 @@
+#pragma once
+
+#include "common.h"
+
+// Payload size of the vendor feature report, the report id is handled by tinyusb
+#define VENDOR_REPORT_SIZE 63
+
+// The host selects what to read with a SET_FEATURE of [command, argument] and then reads it back with a GET_FEATURE.
+// Every response starts with [command, argument] followed by the command specific data.
+typedef enum {
+    VENDOR_CMD_NONE,
+
+    // argument: first pin. Returns [count, ButtonStats * count]
+    VENDOR_CMD_BUTTON_STATS,
+    // Clears all button statistics, also in flash
+    VENDOR_CMD_RESET_BUTTON_STATS,
+    // Returns u32 * BOOT_PHASE_COUNT, the microseconds after reset at which each boot phase completed
+    VENDOR_CMD_BOOT_TIMES,
+    // Returns FrameStats, how many frames ran the user callback and how many reused the previous report
+    VENDOR_CMD_FRAME_STATS,
+    // Returns [count, SchedulerTaskStats * count] in scheduler priority order
+    VENDOR_CMD_SCHEDULER_STATS,
+    // Returns [count, InputSourceStats * count], the latency each input source adds
+    VENDOR_CMD_INPUT_SOURCES,
+    // argument: block, bit 7 selects the current boot instead of the previous one.
+    // Returns up to POSTMORTEM_BLOCK_SIZE bytes of the PostMortemLog at block * POSTMORTEM_BLOCK_SIZE, nothing past the end.
+    VENDOR_CMD_POSTMORTEM,
+    // Plugin upload, see plugin.h. [command, 0, size u32] starts an upload of size bytes.
+    VENDOR_CMD_PLUGIN_BEGIN,
+    // argument: byte count. [command, count, offset u16, data * count], at most VENDOR_REPORT_SIZE - 4 bytes per chunk.
+    VENDOR_CMD_PLUGIN_DATA,
+    // Checks, stores and loads the uploaded plugin
+    VENDOR_CMD_PLUGIN_COMMIT,
+    // Returns PluginStatus, as do the other plugin commands
+    VENDOR_CMD_PLUGIN_STATUS,
+    // [command, 0, frames u32] starts the stress pattern for frames reports, 0 stops it. Returns [remaining u32, sent u32],
+    // both 0 after a start the box refused (see platform_stress).
+    VENDOR_CMD_STRESS,
+} VendorCommand;
+
+void vendor_set_report(const u8 *buffer, u16 len);
+u16 vendor_get_report(u8 *buffer, u16 len);
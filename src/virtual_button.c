@@ -1,31 +1,156 @@
 #include "virtual_button.h"
+#include "settings.h"
+#include "temporal.h"
 #include "platform/platform.h"
 
 static u64 _state = 0;
 static u64 _last_state = 0;
 
+// Physical inputs that pressed each virtual button this frame
+static InputMask _sources[VIRTUAL_BUTTON_COUNT] = {0};
+
+typedef struct {
+    // Buttons declared with this pattern this frame and the ones of them held on the last frame
+    u64 buttons;
+    u64 held;
+    // Report tick at which the pattern last started
+    u32 origin;
+    u8 on;
+    u8 off;
+} _TurboPattern;
+
+static _TurboPattern _turbo[TURBO_PATTERNS] = {0};
+
+static inline u64 _bit(VirtualButton button) {
+    return (u64)1 << button;
+}
+
 void press(VirtualButton button) {
-    _state |= (1 << button);
+    _state |= _bit(button);
+}
+
+void bind(int index, VirtualButton button) {
+    if (!button_down(index)) return;
+    _state |= _bit(button);
+    _sources[button] |= INPUT_BIT(index);
+}
+
+void bind_pins(InputMask pins, VirtualButton button) {
+    if (!pins) return;
+    _state |= _bit(button);
+    _sources[button] |= pins;
 }
 
 void release(VirtualButton button) {
-    _state &= ~(1 << button);
+    _state &= ~_bit(button);
+    _sources[button] = 0;
 }
 
 void release_all(void) {
     _state = 0;
+    memset(_sources, 0, sizeof(_sources));
+
+    // Only the declarations, the phases carry over to the next frame
+    for (int i = 0; i < TURBO_PATTERNS; ++i) _turbo[i].buttons = 0;
 }
 
 void toggle(VirtualButton button) {
-    _state ^= (1 << button);
+    _state ^= _bit(button);
 }
 
-static inline bool _down(VirtualButton button) {
-    return !!(_state & (1 << button));
+bool turbo(u64 buttons, u8 on_ticks, u8 off_ticks) {
+    if (on_ticks == 0 || off_ticks == 0) return false;
+
+    _TurboPattern *unused = NULL;
+    for (int i = 0; i < TURBO_PATTERNS; ++i) {
+        _TurboPattern *pattern = &_turbo[i];
+
+        if (pattern->on == on_ticks && pattern->off == off_ticks) {
+            pattern->buttons |= buttons;
+            return true;
+        }
+
+        if (!unused && !pattern->buttons && !pattern->held) unused = pattern;
+    }
+
+    if (!unused) return false;
+
+    *unused = (_TurboPattern) {.buttons = buttons, .on = on_ticks, .off = off_ticks};
+    return true;
 }
 
-static inline bool _pressed(VirtualButton button) {
-    return (_state & (1 << button)) && !(_last_state & (1 << button));
+u64 apply_turbo(u64 state) {
+    u32 tick = platform_report_tick();
+
+    for (int i = 0; i < TURBO_PATTERNS; ++i) {
+        _TurboPattern *pattern = &_turbo[i];
+
+        u64 held = state & pattern->buttons;
+        if (!held) {
+            pattern->held = 0;
+            continue;
+        }
+
+        if (!pattern->held) pattern->origin = tick;
+        pattern->held = held;
+
+        if ((tick - pattern->origin) % (pattern->on + pattern->off) >= pattern->on) state &= ~pattern->buttons;
+
+        // The output changes on later ticks without any new input
+        platform_request_update();
+    }
+
+    return state;
+}
+
+#define _GAMEPAD_BUTTON_MASK ((1ul << (EXTRA_8 - ATTACK_1 + 1)) - 1)
+
+static const KeyCode _default_keymap[VIRTUAL_BUTTON_COUNT] = {
+    [UP]       = KEY_W,
+    [DOWN]     = KEY_S,
+    [LEFT]     = KEY_A,
+    [RIGHT]    = KEY_D,
+
+    [ATTACK_1] = KEY_U,
+    [ATTACK_2] = KEY_I,
+    [ATTACK_3] = KEY_O,
+    [ATTACK_4] = KEY_P,
+    [ATTACK_5] = KEY_H,
+    [ATTACK_6] = KEY_J,
+    [ATTACK_7] = KEY_K,
+    [ATTACK_8] = KEY_L,
+
+    [MACRO_1]  = KEY_Q,
+    [MACRO_2]  = KEY_C,
+    [MACRO_3]  = KEY_V,
+    [MACRO_4]  = KEY_B,
+    [MACRO_5]  = KEY_N,
+
+    [UTILITY]  = KEY_9,
+
+    [EXTRA_1]  = KEY_1,
+    [EXTRA_2]  = KEY_2,
+    [EXTRA_3]  = KEY_3,
+    [EXTRA_4]  = KEY_4,
+    [EXTRA_5]  = KEY_5,
+    [EXTRA_6]  = KEY_6,
+    [EXTRA_7]  = KEY_7,
+    [EXTRA_8]  = KEY_8,
+
+    [SPECIAL_ESCAPE]    = KEY_ESCAPE,
+    [SPECIAL_ENTER]     = KEY_ENTER,
+    [SPECIAL_BACKSPACE] = KEY_BACKSPACE,
+    [SPECIAL_SHIFT]     = KEY_SHIFT_LEFT,
+    [SPECIAL_ALT]       = KEY_ALT_LEFT,
+    [SPECIAL_TAB]       = KEY_TAB,
+    [SPECIAL_CONTROL]   = KEY_CONTROL_LEFT,
+    [SPECIAL_PAGE_UP]   = KEY_PAGE_UP,
+    [SPECIAL_PAGE_DOWN] = KEY_PAGE_DOWN,
+};
+
+static inline KeyCode _key(const KeyCode *keymap, int button) {
+    if (keymap && keymap[button] != KEY_NONE) return keymap[button];
+    return _default_keymap[button];
 }
 
 static DPadDirection _vec2_to_dpad_direction(int x, int y) {
@@ -44,187 +169,88 @@ static DPadDirection _vec2_to_dpad_direction(int x, int y) {
     return result;
 }
 
-static void _send_keyboard_input(SocdType socd) {
+u64 resolve_socd(u64 buttons, SocdType socd) {
+    bool left = buttons & _bit(LEFT);
+    bool right = buttons & _bit(RIGHT);
+    bool up = buttons & _bit(UP);
+    bool down = buttons & _bit(DOWN);
+
     switch (socd) {
-        case SOCD_NATURAL: {
-            if (_down(RIGHT)) keyboard_press(KEY_D);
-            if (_down(LEFT))  keyboard_press(KEY_A);
-            if (_down(UP))    keyboard_press(KEY_W);
-            if (_down(DOWN))  keyboard_press(KEY_S);
-        } break;
+        case SOCD_NATURAL:
+            break;
 
         case SOCD_NEUTRAL: {
-            if (_down(RIGHT) && !_down(LEFT)) keyboard_press(KEY_D);
-            if (_down(LEFT) && !_down(RIGHT)) keyboard_press(KEY_A);
-            if (_down(UP) && !_down(DOWN))    keyboard_press(KEY_W);
-            if (_down(DOWN) && !_down(UP))    keyboard_press(KEY_S);
+            if (left && right) buttons &= ~(_bit(LEFT) | _bit(RIGHT));
+            if (up && down)    buttons &= ~(_bit(UP) | _bit(DOWN));
         } break;
 
         case SOCD_ABSOLUTE: {
-            if (_down(RIGHT) && !_down(LEFT)) keyboard_press(KEY_D);
-            if (_down(LEFT) && !_down(RIGHT)) keyboard_press(KEY_A);
-            if (_down(UP))                    keyboard_press(KEY_W);
-            if (_down(DOWN) && !_down(UP))    keyboard_press(KEY_S);
+            if (left && right) buttons &= ~(_bit(LEFT) | _bit(RIGHT));
+            if (up && down)    buttons &= ~_bit(DOWN);
         } break;
 
         case SOCD_LAST_INPUT: {
-            static bool left_was_first = false;
-            static bool right_was_first = false;
-            static bool both_were_pressed = false;
-
-            if (!left_was_first && !right_was_first && !both_were_pressed) {
-                if (_down(LEFT) && _down(RIGHT)) both_were_pressed = true;
-                else if (_down(LEFT))               left_was_first = true;
-                else if (_down(RIGHT))              right_was_first = true;
+            // Left + Right resolves to the one pressed last. If both were pressed at the same time resolve to neutral
+            if (left && right) {
+                i32 order = virtual_press_order(RIGHT, LEFT);
+                if (order >= 0) buttons &= ~_bit(LEFT);
+                if (order <= 0) buttons &= ~_bit(RIGHT);
             }
 
-            if (both_were_pressed) { // If both were pressed at the same time resolve to neutral and wait untill they are released
-                if (!_down(LEFT) || !_down(RIGHT)) both_were_pressed = false;
-            }
-            else if (left_was_first) { // If left was pressed first and right was pressed after, resolve to right
-                if (!_down(LEFT)) left_was_first = false;
-
-                if (_down(RIGHT))     keyboard_press(KEY_D);
-                else if (_down(LEFT)) keyboard_press(KEY_A);
-            }
-            else if (right_was_first) { // If right was pressed first and left was pressed after, resolve to left
-                if (!_down(RIGHT)) right_was_first = false;
-
-                if (_down(LEFT))       keyboard_press(KEY_A);
-                else if (_down(RIGHT)) keyboard_press(KEY_D);
-            }
-            
-            if (_down(UP))                    keyboard_press(KEY_W);
-            if (_down(DOWN) && !_down(UP))    keyboard_press(KEY_S);
+            if (up && down) buttons &= ~_bit(DOWN);
         } break;
     }
 
-    if (_down(ATTACK_1)) keyboard_press(KEY_U);
-    if (_down(ATTACK_2)) keyboard_press(KEY_I);
-    if (_down(ATTACK_3)) keyboard_press(KEY_O);
-    if (_down(ATTACK_4)) keyboard_press(KEY_P);
-    if (_down(ATTACK_5)) keyboard_press(KEY_H);
-    if (_down(ATTACK_6)) keyboard_press(KEY_J);
-    if (_down(ATTACK_7)) keyboard_press(KEY_K);
-    if (_down(ATTACK_8)) keyboard_press(KEY_L);
-
-    if (_down(MACRO_1))  keyboard_press(KEY_Q);
-    if (_down(MACRO_2))  keyboard_press(KEY_C);
-    if (_down(MACRO_3))  keyboard_press(KEY_V);
-    if (_down(MACRO_4))  keyboard_press(KEY_B);
-    if (_down(MACRO_5))  keyboard_press(KEY_N);
-
-    if (_down(UTILITY))  keyboard_press(KEY_9);
-
-    if (_down(EXTRA_1))  keyboard_press(KEY_1);
-    if (_down(EXTRA_2))  keyboard_press(KEY_2);
-    if (_down(EXTRA_3))  keyboard_press(KEY_3);
-    if (_down(EXTRA_4))  keyboard_press(KEY_4);
-    if (_down(EXTRA_5))  keyboard_press(KEY_5);
-    if (_down(EXTRA_6))  keyboard_press(KEY_6);
-    if (_down(EXTRA_7))  keyboard_press(KEY_7);
-    if (_down(EXTRA_8))  keyboard_press(KEY_8);
-
-    if (_down(SPECIAL_ESCAPE))    keyboard_press(KEY_ESCAPE);
-    if (_down(SPECIAL_ENTER))     keyboard_press(KEY_ENTER);
-    if (_down(SPECIAL_BACKSPACE)) keyboard_press(KEY_BACKSPACE);
-    if (_down(SPECIAL_SHIFT))     keyboard_press(KEY_SHIFT_LEFT);
-    if (_down(SPECIAL_ALT))       keyboard_press(KEY_ALT_LEFT);
-    if (_down(SPECIAL_TAB))       keyboard_press(KEY_TAB);
-    if (_down(SPECIAL_CONTROL))   keyboard_press(KEY_CONTROL_LEFT);
-    if (_down(SPECIAL_PAGE_UP))   keyboard_press(KEY_PAGE_UP);
-    if (_down(SPECIAL_PAGE_DOWN)) keyboard_press(KEY_PAGE_DOWN);
+    return buttons;
 }
 
-// Not sure if I should use the dpad or the left joystick for movement.
-static void _send_gamepad_input(SocdType socd) {
-    int x = 0;
-    int y = 0;
-    
-    switch (socd) {
-        case SOCD_NATURAL:
-        case SOCD_NEUTRAL: {
-            if (_down(RIGHT) && !_down(LEFT)) x += 1;
-            if (_down(LEFT) && !_down(RIGHT)) x -= 1;
-            if (_down(UP) && !_down(DOWN))    y += 1;
-            if (_down(DOWN) && !_down(UP))    y -= 1;
-        } break;
+// Resolves the held directions into a vector with x right and y up. Opposites left after resolution cancel out.
+static void _resolve_direction(u64 buttons, SocdType socd, int *out_x, int *out_y) {
+    buttons = resolve_socd(buttons, socd);
 
-        case SOCD_ABSOLUTE: {
-            if (_down(RIGHT) && !_down(LEFT)) x += 1;
-            if (_down(LEFT) && !_down(RIGHT)) x -= 1;
-            if (_down(UP))                    y += 1;
-            if (_down(DOWN) && !_down(UP))    y -= 1;
-        } break;
-
-        case SOCD_LAST_INPUT: {
-            static bool left_was_first = false;
-            static bool right_was_first = false;
-            static bool both_were_pressed = false;
-
-            if (!left_was_first && !right_was_first && !both_were_pressed) {
-                if (_down(LEFT) && _down(RIGHT)) both_were_pressed = true;
-                else if (_down(LEFT))               left_was_first = true;
-                else if (_down(RIGHT))              right_was_first = true;
-            }
-
-            if (both_were_pressed) { // If both were pressed at the same time resolve to neutral and wait untill they are released
-                if (!_down(LEFT) || !_down(RIGHT)) both_were_pressed = false;
-            }
-            else if (left_was_first) { // If left was pressed first and right was pressed after, resolve to right
-                if (!_down(LEFT)) left_was_first = false;
+    *out_x = !!(buttons & _bit(RIGHT)) - !!(buttons & _bit(LEFT));
+    *out_y = !!(buttons & _bit(UP)) - !!(buttons & _bit(DOWN));
+}
 
-                if (_down(RIGHT))     x += 1;
-                else if (_down(LEFT)) x -= 1;
-            }
-            else if (right_was_first) { // If right was pressed first and left was pressed after, resolve to left
-                if (!_down(RIGHT)) right_was_first = false;
+u8 virtual_direction(SocdType socd) {
+    int x, y;
+    _resolve_direction(_state, socd, &x, &y);
+    return (u8) (5 + x + 3 * y);
+}
 
-                if (_down(LEFT))       x -= 1;
-                else if (_down(RIGHT)) x += 1;
-            }
-            
-            if (_down(UP))                    y += 1;
-            if (_down(DOWN) && !_down(UP))    y -= 1;
-        } break;
+static void _encode_keyboard(u64 buttons, const KeyCode *keymap) {
+    for (; buttons; buttons &= buttons - 1) {
+        keyboard_press(_key(keymap, __builtin_ctzll(buttons)));
     }
+}
+
+// Not sure if I should use the dpad or the left joystick for movement.
+static void _encode_gamepad(u64 buttons) {
+    int x, y;
+    _resolve_direction(buttons, SOCD_NATURAL, &x, &y);
 
     gamepad_dpad(_vec2_to_dpad_direction(x, y));
-    
-    if (_down(ATTACK_1)) gamepad_button_press(GAMEPAD_BUTTON(0));
-    if (_down(ATTACK_2)) gamepad_button_press(GAMEPAD_BUTTON(1));
-    if (_down(ATTACK_3)) gamepad_button_press(GAMEPAD_BUTTON(2));
-    if (_down(ATTACK_4)) gamepad_button_press(GAMEPAD_BUTTON(3));
-    if (_down(ATTACK_5)) gamepad_button_press(GAMEPAD_BUTTON(4));
-    if (_down(ATTACK_6)) gamepad_button_press(GAMEPAD_BUTTON(5));
-    if (_down(ATTACK_7)) gamepad_button_press(GAMEPAD_BUTTON(6));
-    if (_down(ATTACK_8)) gamepad_button_press(GAMEPAD_BUTTON(7));
-
-    if (_down(MACRO_1))  gamepad_button_press(GAMEPAD_BUTTON(8));
-    if (_down(MACRO_2))  gamepad_button_press(GAMEPAD_BUTTON(9));
-    if (_down(MACRO_3))  gamepad_button_press(GAMEPAD_BUTTON(10));
-    if (_down(MACRO_4))  gamepad_button_press(GAMEPAD_BUTTON(11));
-    if (_down(MACRO_5))  gamepad_button_press(GAMEPAD_BUTTON(12));
-
-    if (_down(UTILITY))  gamepad_button_press(GAMEPAD_BUTTON(13));
-
-    if (_down(EXTRA_1))  gamepad_button_press(GAMEPAD_BUTTON(14));
-    if (_down(EXTRA_2))  gamepad_button_press(GAMEPAD_BUTTON(15));
-    if (_down(EXTRA_3))  gamepad_button_press(GAMEPAD_BUTTON(16));
-    if (_down(EXTRA_4))  gamepad_button_press(GAMEPAD_BUTTON(17));
-    if (_down(EXTRA_5))  gamepad_button_press(GAMEPAD_BUTTON(18));
-    if (_down(EXTRA_6))  gamepad_button_press(GAMEPAD_BUTTON(19));
-    if (_down(EXTRA_7))  gamepad_button_press(GAMEPAD_BUTTON(20));
-    if (_down(EXTRA_8))  gamepad_button_press(GAMEPAD_BUTTON(21));
-}
-
-void send_inputs(SocdType socd) {
-    InputMode mode = platform_get_mode();
-
-    switch (mode) {
-        case MODE_KEYBOARD: _send_keyboard_input(socd); break;
-        case MODE_GAMEPAD: _send_gamepad_input(socd); break;
-    }
 
+    // ATTACK_1 to EXTRA_8 are laid out in the same order as the gamepad buttons
+    gamepad_button_press((u32) (buttons >> ATTACK_1) & _GAMEPAD_BUTTON_MASK);
+}
+
+u64 latch_inputs(void) {
+    // Timestamp the edges first so socd resolution can use this frame's ordering
+    temporal_button_edges(_state, _last_state, _sources);
     _last_state = _state;
+    return _state;
+}
+
+void encode_inputs(u64 buttons, const KeyCode *keymap) {
+    switch (platform_get_mode()) {
+        case MODE_KEYBOARD: _encode_keyboard(buttons, keymap); break;
+        case MODE_GAMEPAD: _encode_gamepad(buttons); break;
+    }
+}
+
+void send_inputs(SocdType socd, const KeyCode *keymap) {
+    // Turbo only shapes the output, timing and press detection keep seeing the buttons as held
+    u64 held = latch_inputs();
+    encode_inputs(resolve_socd(apply_turbo(held), socd), keymap);
 }
@@ -1,6 +1,12 @@
 #pragma once
 
 #include "common.h"
+#include "platform/keycodes.h"
+#include "platform/platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 typedef enum {
     UP, 
@@ -44,6 +50,8 @@ typedef enum {
     SPECIAL_CONTROL,
     SPECIAL_PAGE_UP,
     SPECIAL_PAGE_DOWN,
+
+    VIRTUAL_BUTTON_COUNT,
 } VirtualButton;
 
 typedef enum {
@@ -61,8 +69,38 @@ typedef enum {
 } SocdType;
 
 void press(VirtualButton button);
+// Presses the virtual button if the physical button is down and remembers the pin as its source for timing
+void bind(int index, VirtualButton button);
+// Presses the virtual button with the given held pins as its sources. Does nothing if pins is 0.
+void bind_pins(InputMask pins, VirtualButton button);
 void release(VirtualButton button);
 void release_all(void);
 void toggle(VirtualButton button);
 
-void send_inputs(SocdType socd);
\ No newline at end of file
+// While held, the buttons in the mask alternate between on_ticks pressed and off_ticks released, counted in
+// platform_report_tick so every state reaches the host for exactly that many usb frames. Buttons with the same
+// pattern share one phase, which restarts pressed when the first of them goes down. Declared every frame like the
+// bindings, release_all clears it. Returns false if TURBO_PATTERNS different patterns are already in use.
+bool turbo(u64 buttons, u8 on_ticks, u8 off_ticks);
+
+// Held directions after socd resolution in numpad notation, 5 is neutral. Natural socd resolves opposites to
+// neutral here like it does on the gamepad.
+u8 virtual_direction(SocdType socd);
+
+// keymap overrides the default key of each virtual button in keyboard mode. NULL or KEY_NONE entries use the default.
+// Same as encode_inputs(resolve_socd(apply_turbo(latch_inputs()), socd), keymap).
+void send_inputs(SocdType socd, const KeyCode *keymap);
+
+// The steps of send_inputs, for profiles that put their own stages in between (see pipeline.hpp).
+// Timestamps this frame's virtual edges and returns the held virtual buttons. Once per frame, before the others.
+u64 latch_inputs(void);
+// Masks out the turbo buttons that are in their off phase on this tick
+u64 apply_turbo(u64 buttons);
+// Clears the opposing directions socd cancels. Natural keeps both, they still cancel out on the gamepad.
+u64 resolve_socd(u64 buttons, SocdType socd);
+// Writes buttons into the report of the current mode
+void encode_inputs(u64 buttons, const KeyCode *keymap);
+
+#ifdef __cplusplus
+}
+#endif
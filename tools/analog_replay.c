@@ -0,0 +1,77 @@
+// Runs a stream of analog readings through the firmware's decision logic (src/analog.c) and prints every press
+// and release, so actuation and rapid trigger settings can be checked against real sensor data on the host.
+//
+// usage: analog_replay <stream> [actuation hysteresis rapid_press rapid_release]
+//
+// The stream has one line per scan with one averaged raw reading per analog pin, '#' starts a comment.
+// The first line calibrates the rest position like the first adc burst does on the pico.
+// Settings default to the ANALOG_* values in settings.h, travel values are in 1/1024 of the key travel.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/analog.h"
+#include "src/settings.h"
+
+#define _MAX_CHANNELS 3
+
+int main(int argc, char **argv) {
+    if (argc != 2 && argc != 6) {
+        fprintf(stderr, "usage: %s <stream> [actuation hysteresis rapid_press rapid_release]\n", argv[0]);
+        return 1;
+    }
+
+    AnalogConfig config = {ANALOG_ACTUATION, ANALOG_HYSTERESIS, ANALOG_RAPID_PRESS, ANALOG_RAPID_RELEASE};
+    if (argc == 6) {
+        config.actuation = atoi(argv[2]);
+        config.hysteresis = atoi(argv[3]);
+        config.rapid_press = atoi(argv[4]);
+        config.rapid_release = atoi(argv[5]);
+    }
+
+    FILE *file = fopen(argv[1], "r");
+    if (!file) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    AnalogChannel channels[_MAX_CHANNELS];
+    u32 presses[_MAX_CHANNELS] = {0};
+    int count = 0;
+    u32 scan = 0;
+    char line[256];
+
+    printf("# scan channel event travel\n");
+
+    while (fgets(line, sizeof(line), file)) {
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        int values[_MAX_CHANNELS];
+        int found = sscanf(line, "%d %d %d", &values[0], &values[1], &values[2]);
+        if (found <= 0) continue;
+
+        if (count == 0) {
+            count = found;
+            for (int i = 0; i < count; ++i) analog_init(&channels[i], &config, (u16) values[i], ANALOG_RANGE);
+        }
+
+        for (int i = 0; i < count && i < found; ++i) {
+            bool was_down = channels[i].down;
+            bool down = analog_update(&channels[i], (u16) values[i]);
+
+            if (down != was_down) {
+                printf("%u %d %s %u\n", scan, i, down ? "press" : "release", channels[i].travel);
+                if (down) presses[i] += 1;
+            }
+        }
+
+        scan += 1;
+    }
+
+    fclose(file);
+
+    for (int i = 0; i < count; ++i) printf("# channel %d: %u presses\n", i, presses[i]);
+    return 0;
+}
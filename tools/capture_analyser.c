@@ -0,0 +1,559 @@
+// Offline analyser for usb captures of the cheatbox. Decodes the input reports with the firmware's own report
+// descriptor and measures report cadence, jitter, repeats, losses and transition timing.
+//
+// usage: capture_analyser [-d device] [-i interval_us] <capture> [other capture]
+//
+// A capture can be a usbmon pcap (tcpdump or wireshark on usbmonN), a usbmon text dump
+// (cat /sys/kernel/debug/usb/usbmon/Nu) or a trace of the linux port (CHEATBOX_TRACE=1).
+// -d keeps only the given usb device number, -i sets the expected report interval, by default the median interval of
+// each capture is used so builds with different polling rates can be compared.
+// With two captures of the same input, e.g. from two firmware builds, both are shown side by side and their state
+// transitions are matched up one by one.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/common.h"
+#include "src/settings.h"
+#include "src/platform/report_descriptor.h"
+
+#define _MAX_REPORT 64
+
+// Interval histogram bins in microseconds, the last bin holds everything longer
+#define _BIN_US 250
+#define _BINS 17
+
+// Transitions further apart than this are not taken to be the same input
+#define _MATCH_WINDOW_US 20000.0
+
+#define _PCAP_MAGIC_US 0xA1B2C3D4u
+#define _PCAP_MAGIC_NS 0xA1B23C4Du
+#define _LINKTYPE_USB_LINUX 189
+#define _LINKTYPE_USB_LINUX_MMAPPED 220
+
+// Where the timing field sits in each input report, found by walking the descriptor
+typedef struct {
+    bool known;
+    u16 bytes;
+    // Byte offsets after the report id, -1 if the report has no timing field
+    i32 sequence;
+    i32 latency;
+    // Bytes that are not input state (timing field, padding is kept)
+    bool ignored[_MAX_REPORT];
+} _Layout;
+
+typedef struct {
+    u64 time_us;
+    u8 id;
+    u8 len;
+    u8 data[_MAX_REPORT];
+} _Report;
+
+typedef struct {
+    const char *path;
+    _Report *reports;
+    size_t count;
+    size_t capacity;
+} _Capture;
+
+typedef struct {
+    size_t reports;
+    double duration_ms;
+    double expected_us;
+
+    u32 histogram[_BINS];
+    double interval_mean_us;
+    double interval_stddev_us;
+    double interval_max_us;
+
+    // Same state as the previous report, the firmware repeats held state every frame
+    size_t repeated;
+    // Gaps in the report sequence number, reports the firmware queued that never showed up
+    size_t lost;
+    // Report intervals that went by without a report, idle ones are left out on purpose by the firmware
+    size_t suppressed_idle;
+    size_t missing_held;
+    size_t transitions;
+
+    size_t latency_count;
+    double latency_mean_us;
+    double latency_max_us;
+} _Metrics;
+
+static _Layout _layouts[256];
+static int _device = -1;
+static double _interval_us = 0;
+
+static u32 _read_u32(const u8 *data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((u32) data[3] << 24);
+}
+
+static u64 _read_u64(const u8 *data) {
+    return _read_u32(data) | ((u64) _read_u32(data + 4) << 32);
+}
+
+static void _parse_descriptor(const u8 *desc, size_t len) {
+    u32 usage_page = 0, report_size = 0, report_count = 0, report_id = 0;
+    u32 usage = 0;
+    u32 bits[256] = {0};
+
+    for (size_t i = 0; i < len;) {
+        u8 prefix = desc[i];
+        if (prefix == 0xFE) {
+            // Long item, never used by this descriptor
+            i += 3 + (i + 1 < len ? desc[i + 1] : 0);
+            continue;
+        }
+
+        u8 size = prefix & 0x3;
+        if (size == 3) size = 4;
+        u8 type = (prefix >> 2) & 0x3;
+        u8 tag = prefix >> 4;
+
+        u32 value = 0;
+        for (u8 b = 0; b < size && i + 1 + b < len; ++b) value |= (u32) desc[i + 1 + b] << (8 * b);
+        i += 1 + size;
+
+        if (type == 1) {
+            switch (tag) {
+                case 0: usage_page = value; break;
+                case 7: report_size = value; break;
+                case 8: report_id = value & 0xFF; break;
+                case 9: report_count = value; break;
+            }
+        }
+        else if (type == 2) {
+            // Usage, or the start of a usage range
+            if (tag == 0 || tag == 1) usage = value;
+        }
+        else if (type == 0) {
+            if (tag == 0x8) {
+                _Layout *layout = &_layouts[report_id];
+                u32 offset = bits[report_id];
+                u32 width = report_size * report_count;
+
+                if (!layout->known) {
+                    layout->known = true;
+                    layout->sequence = -1;
+                    layout->latency = -1;
+                }
+
+                if (usage_page == 0xFF00) {
+                    for (u32 bit = offset; bit < offset + width && bit / 8 < _MAX_REPORT; bit += 8) {
+                        layout->ignored[bit / 8] = true;
+                    }
+                    if (usage == 3 && report_size == 16) layout->sequence = offset / 8;
+                    if (usage == 5 && report_size == 16) layout->latency = offset / 8;
+                }
+
+                bits[report_id] += width;
+                layout->bytes = (bits[report_id] + 7) / 8;
+            }
+
+            usage = 0;
+        }
+    }
+}
+
+static void _push(_Capture *capture, u64 time_us, const u8 *data, u32 len) {
+    // Only reports the descriptor declares as input
+    if (len < 1 || !_layouts[data[0]].known) return;
+
+    if (capture->count == capture->capacity) {
+        capture->capacity = capture->capacity ? capture->capacity * 2 : 1024;
+        capture->reports = realloc(capture->reports, capture->capacity * sizeof(_Report));
+    }
+
+    _Report *report = &capture->reports[capture->count++];
+    report->time_us = time_us;
+    report->id = data[0];
+    report->len = len - 1 > _MAX_REPORT ? _MAX_REPORT : len - 1;
+    memcpy(report->data, data + 1, report->len);
+}
+
+static bool _load_pcap(_Capture *capture, FILE *file) {
+    u8 header[24];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header)) return false;
+
+    bool nanoseconds = _read_u32(header) == _PCAP_MAGIC_NS;
+    u32 linktype = _read_u32(header + 20);
+
+    u32 usbmon_len;
+    if (linktype == _LINKTYPE_USB_LINUX) usbmon_len = 48;
+    else if (linktype == _LINKTYPE_USB_LINUX_MMAPPED) usbmon_len = 64;
+    else {
+        fprintf(stderr, "%s: link type %u is not usbmon\n", capture->path, linktype);
+        return false;
+    }
+
+    u8 record[16];
+    static u8 packet[65536];
+
+    while (fread(record, 1, sizeof(record), file) == sizeof(record)) {
+        u32 captured = _read_u32(record + 8);
+        if (captured > sizeof(packet) || fread(packet, 1, captured, file) != captured) break;
+        if (captured < usbmon_len) continue;
+
+        // struct usbmon_packet: completions of interrupt in transfers carry the reports
+        u8 event = packet[8];
+        u8 transfer = packet[9];
+        u8 endpoint = packet[10];
+        u8 device = packet[11];
+        if (event != 'C' || transfer != 1 || !(endpoint & 0x80)) continue;
+        if (_device >= 0 && device != _device) continue;
+
+        u64 time_us = _read_u64(packet + 16) * 1000000 + _read_u32(packet + 24);
+        if (nanoseconds) time_us = (u64) _read_u32(record) * 1000000 + _read_u32(record + 4) / 1000;
+
+        _push(capture, time_us, packet + usbmon_len, captured - usbmon_len);
+    }
+
+    return true;
+}
+
+static int _hex(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Appends the bytes of a hex string like "0a1b2c3d"
+static u32 _parse_hex(const char *text, u8 *data, u32 len, u32 max) {
+    for (; text[0] && text[1] && len < max; text += 2) {
+        int high = _hex(text[0]), low = _hex(text[1]);
+        if (high < 0 || low < 0) break;
+        data[len++] = (u8) (high << 4 | low);
+    }
+    return len;
+}
+
+// usbmon text: "<tag> <time_us> C Ii:<bus>:<dev>:<ep> <status> <length> = <hex words>"
+static void _parse_usbmon_line(_Capture *capture, char *line) {
+    char *tokens[32];
+    int count = 0;
+    for (char *token = strtok(line, " \t\n"); token && count < 32; token = strtok(NULL, " \t\n")) tokens[count++] = token;
+    if (count < 7 || strcmp(tokens[2], "C") != 0 || strncmp(tokens[3], "Ii:", 3) != 0) return;
+
+    // Older kernels leave out the bus number
+    int parts[3] = {0}, found = 0;
+    for (char *field = tokens[3] + 3; *field && found < 3; ++found) {
+        parts[found] = (int) strtol(field, &field, 10);
+        if (*field == ':') field += 1;
+    }
+    int device = found == 3 ? parts[1] : parts[0];
+    if (_device >= 0 && device != _device) return;
+
+    int data_start = -1;
+    for (int i = 6; i < count; ++i) {
+        if (strcmp(tokens[i], "=") == 0) data_start = i + 1;
+    }
+    if (data_start < 0) return;
+
+    u8 data[_MAX_REPORT + 1];
+    u32 len = 0;
+    for (int i = data_start; i < count; ++i) len = _parse_hex(tokens[i], data, len, sizeof(data));
+
+    _push(capture, strtoull(tokens[1], NULL, 10), data, len);
+}
+
+// Linux port trace: "<time_us> <report_id> <hex bytes>"
+static void _parse_trace_line(_Capture *capture, char *line) {
+    char *tokens[_MAX_REPORT + 2];
+    int count = 0;
+    for (char *token = strtok(line, " \t\n"); token && count < _MAX_REPORT + 2; token = strtok(NULL, " \t\n")) {
+        tokens[count++] = token;
+    }
+    if (count < 2) return;
+
+    u8 data[_MAX_REPORT + 1];
+    data[0] = (u8) atoi(tokens[1]);
+    u32 len = 1;
+    for (int i = 2; i < count; ++i) len = _parse_hex(tokens[i], data, len, sizeof(data));
+
+    _push(capture, strtoull(tokens[0], NULL, 10), data, len);
+}
+
+static bool _load_text(_Capture *capture, FILE *file) {
+    char line[1024];
+    int usbmon = -1;
+
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+
+        // usbmon lines have the event type as their third field
+        if (usbmon < 0) {
+            char tag[64], time[64], event[8];
+            usbmon = sscanf(line, "%63s %63s %7s", tag, time, event) == 3 && strlen(event) == 1;
+        }
+
+        if (usbmon) _parse_usbmon_line(capture, line);
+        else        _parse_trace_line(capture, line);
+    }
+
+    return true;
+}
+
+static bool _load(_Capture *capture, const char *path) {
+    capture->path = path;
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+
+    u8 magic[4] = {0};
+    size_t got = fread(magic, 1, sizeof(magic), file);
+    rewind(file);
+
+    bool pcap = got == 4 && (_read_u32(magic) == _PCAP_MAGIC_US || _read_u32(magic) == _PCAP_MAGIC_NS);
+    bool ok = pcap ? _load_pcap(capture, file) : _load_text(capture, file);
+    fclose(file);
+
+    if (ok && capture->count < 2) {
+        fprintf(stderr, "%s: fewer than 2 input reports\n", path);
+        return false;
+    }
+
+    return ok;
+}
+
+static bool _same_state(const _Report *a, const _Report *b) {
+    if (a->id != b->id) return false;
+
+    const _Layout *layout = &_layouts[a->id];
+    u8 len = a->len < b->len ? a->len : b->len;
+    for (u8 i = 0; i < len; ++i) {
+        if (!layout->ignored[i] && a->data[i] != b->data[i]) return false;
+    }
+
+    return true;
+}
+
+static bool _held(const _Report *report) {
+    const _Layout *layout = &_layouts[report->id];
+    for (u8 i = 0; i < report->len; ++i) {
+        if (!layout->ignored[i] && report->data[i]) return true;
+    }
+
+    return false;
+}
+
+static u16 _field(const _Report *report, i32 offset) {
+    return report->data[offset] | (report->data[offset + 1] << 8);
+}
+
+static int _compare_double(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static void _analyse(const _Capture *capture, _Metrics *metrics) {
+    memset(metrics, 0, sizeof(*metrics));
+
+    const _Report *reports = capture->reports;
+    size_t count = capture->count;
+
+    metrics->reports = count;
+    metrics->duration_ms = (reports[count - 1].time_us - reports[0].time_us) / 1000.0;
+
+    double sum = 0, sum_squares = 0, latency_sum = 0;
+
+    metrics->expected_us = _interval_us;
+    if (metrics->expected_us <= 0) {
+        double *intervals = malloc((count - 1) * sizeof(double));
+        for (size_t i = 1; i < count; ++i) intervals[i - 1] = (double) (reports[i].time_us - reports[i - 1].time_us);
+        qsort(intervals, count - 1, sizeof(double), _compare_double);
+        metrics->expected_us = fmax(1.0, intervals[(count - 1) / 2]);
+        free(intervals);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        const _Report *report = &reports[i];
+        const _Layout *layout = &_layouts[report->id];
+
+        if (layout->latency >= 0 && layout->latency + 2 <= report->len) {
+            u16 latency = _field(report, layout->latency);
+            if (latency != REPORT_TIMING_NO_EDGE) {
+                metrics->latency_count += 1;
+                latency_sum += latency;
+                if (latency > metrics->latency_max_us) metrics->latency_max_us = latency;
+            }
+        }
+
+        if (i == 0) continue;
+        const _Report *previous = &reports[i - 1];
+
+        double interval = (double) (report->time_us - previous->time_us);
+        sum += interval;
+        sum_squares += interval * interval;
+        if (interval > metrics->interval_max_us) metrics->interval_max_us = interval;
+
+        u32 bin = (u32) (interval / _BIN_US);
+        metrics->histogram[bin < _BINS ? bin : _BINS - 1] += 1;
+
+        if (_same_state(report, previous)) metrics->repeated += 1;
+        else                               metrics->transitions += 1;
+
+        long expected = lround(interval / metrics->expected_us);
+        if (expected > 1) {
+            if (_held(previous)) metrics->missing_held += expected - 1;
+            else                 metrics->suppressed_idle += expected - 1;
+        }
+
+        if (layout->sequence >= 0 && report->id == previous->id && layout->sequence + 2 <= report->len) {
+            u16 gap = (u16) (_field(report, layout->sequence) - _field(previous, layout->sequence));
+            if (gap > 1) metrics->lost += gap - 1;
+        }
+    }
+
+    double intervals = (double) (count - 1);
+    metrics->interval_mean_us = sum / intervals;
+    metrics->interval_stddev_us = sqrt(fmax(0.0, sum_squares / intervals - metrics->interval_mean_us * metrics->interval_mean_us));
+    if (metrics->latency_count) metrics->latency_mean_us = latency_sum / metrics->latency_count;
+}
+
+static void _print_row(const char *name, const _Metrics *metrics, int count, size_t offset, bool decimal) {
+    printf("%-28s", name);
+    for (int i = 0; i < count; ++i) {
+        const u8 *field = (const u8 *) &metrics[i] + offset;
+        if (decimal) printf(" %14.1f", *(const double *) field);
+        else         printf(" %14zu", *(const size_t *) field);
+    }
+    if (count == 2) {
+        const u8 *a = (const u8 *) &metrics[0] + offset;
+        const u8 *b = (const u8 *) &metrics[1] + offset;
+        if (decimal) printf(" %+14.1f", *(const double *) b - *(const double *) a);
+        else         printf(" %+14lld", (long long) *(const size_t *) b - (long long) *(const size_t *) a);
+    }
+    printf("\n");
+}
+
+#define _ROW(name, field, decimal) _print_row(name, metrics, count, offsetof(_Metrics, field), decimal)
+
+static void _print(const _Capture *captures, const _Metrics *metrics, int count) {
+    printf("%-28s", "");
+    for (int i = 0; i < count; ++i) printf(" %14c", 'A' + i);
+    if (count == 2) printf(" %14s", "B - A");
+    printf("\n");
+
+    _ROW("input reports", reports, false);
+    _ROW("duration ms", duration_ms, true);
+    _ROW("expected interval us", expected_us, true);
+    _ROW("interval mean us", interval_mean_us, true);
+    _ROW("interval stddev us", interval_stddev_us, true);
+    _ROW("interval max us", interval_max_us, true);
+    _ROW("state transitions", transitions, false);
+    _ROW("repeated state", repeated, false);
+    _ROW("lost (sequence gaps)", lost, false);
+    _ROW("suppressed while idle", suppressed_idle, false);
+    _ROW("missing while held", missing_held, false);
+    _ROW("edge latency reports", latency_count, false);
+    _ROW("edge latency mean us", latency_mean_us, true);
+    _ROW("edge latency max us", latency_max_us, true);
+
+    for (int i = 0; i < count; ++i) {
+        printf("\ninterval histogram %c: %s\n", 'A' + i, captures[i].path);
+
+        u32 peak = 1;
+        for (int bin = 0; bin < _BINS; ++bin) if (metrics[i].histogram[bin] > peak) peak = metrics[i].histogram[bin];
+
+        for (int bin = 0; bin < _BINS; ++bin) {
+            if (!metrics[i].histogram[bin]) continue;
+
+            if (bin == _BINS - 1) printf("  >= %5d us %8u ", bin * _BIN_US, metrics[i].histogram[bin]);
+            else                  printf("  %5d-%5d %8u ", bin * _BIN_US, (bin + 1) * _BIN_US, metrics[i].histogram[bin]);
+
+            int width = (int) (40.0 * metrics[i].histogram[bin] / peak + 0.5);
+            for (int c = 0; c < width; ++c) putchar('#');
+            putchar('\n');
+        }
+    }
+}
+
+// Index of the next report that changes state, or count if there is none
+static size_t _next_transition(const _Capture *capture, size_t index) {
+    for (index += 1; index < capture->count; ++index) {
+        if (!_same_state(&capture->reports[index], &capture->reports[index - 1])) break;
+    }
+    return index;
+}
+
+// Pairs up the state transitions of two captures of the same input and compares when they reached the host,
+// relative to the first transition of each capture. A tap that only one capture has, e.g. because a slower build
+// never saw it, is skipped over instead of throwing off every pair after it.
+static void _compare_transitions(const _Capture *a, const _Capture *b) {
+    size_t i = _next_transition(a, 0), j = _next_transition(b, 0);
+    size_t matched = 0, unmatched = 0;
+    u64 origin_a = 0, origin_b = 0;
+    double sum = 0, worst = 0;
+
+    while (i < a->count && j < b->count) {
+        const _Report *ra = &a->reports[i], *rb = &b->reports[j];
+
+        if (matched == 0) {
+            if (!_same_state(ra, rb)) break;
+            origin_a = ra->time_us;
+            origin_b = rb->time_us;
+        }
+
+        double at = (double) (ra->time_us - origin_a), bt = (double) (rb->time_us - origin_b);
+        if (!_same_state(ra, rb) || fabs(bt - at) > _MATCH_WINDOW_US) {
+            if (at < bt) i = _next_transition(a, _next_transition(a, i));
+            else         j = _next_transition(b, _next_transition(b, j));
+            unmatched += 2;
+            continue;
+        }
+
+        sum += bt - at;
+        if (fabs(bt - at) > fabs(worst)) worst = bt - at;
+        matched += 1;
+
+        i = _next_transition(a, i);
+        j = _next_transition(b, j);
+    }
+
+    printf("\ntransitions matched %zu, skipped %zu", matched, unmatched);
+    if (matched == 0) printf(" (the captures start with different states)");
+    printf("\n");
+
+    if (matched > 1) {
+        printf("B - A transition time mean %+.1f us, worst %+.1f us\n", sum / matched, worst);
+    }
+}
+
+int main(int argc, char **argv) {
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg += 2) {
+        if (arg + 1 >= argc) break;
+        if (strcmp(argv[arg], "-d") == 0)      _device = atoi(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-i") == 0) _interval_us = atof(argv[arg + 1]);
+        else break;
+    }
+
+    int count = argc - arg;
+    if (count < 1 || count > 2 || _interval_us < 0) {
+        fprintf(stderr, "usage: %s [-d device] [-i interval_us] <capture> [other capture]\n", argv[0]);
+        return 1;
+    }
+
+    _parse_descriptor(_desc_hid_report, sizeof(_desc_hid_report));
+
+    _Capture captures[2] = {0};
+    _Metrics metrics[2];
+
+    for (int i = 0; i < count; ++i) {
+        if (!_load(&captures[i], argv[arg + i])) return 1;
+        _analyse(&captures[i], &metrics[i]);
+    }
+
+    _print(captures, metrics, count);
+    if (count == 2) _compare_transitions(&captures[0], &captures[1]);
+
+    for (int i = 0; i < count; ++i) free(captures[i].reports);
+    return 0;
+}
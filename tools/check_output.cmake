@@ -0,0 +1,14 @@
+# Runs COMMAND and fails unless it exits with 0 and prints exactly the contents of EXPECTED, for the replay tests.
+# cmake -DCOMMAND="<tool> <args>" -DEXPECTED=<file> -P check_output.cmake
+
+separate_arguments(command UNIX_COMMAND "${COMMAND}")
+execute_process(COMMAND ${command} OUTPUT_VARIABLE output RESULT_VARIABLE result)
+file(READ ${EXPECTED} expected)
+
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "${COMMAND} exited with ${result}:\n${output}")
+endif()
+
+if (NOT output STREQUAL expected)
+    message(FATAL_ERROR "${COMMAND} does not match ${EXPECTED}:\n${output}")
+endif()
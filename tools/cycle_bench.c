@@ -0,0 +1,978 @@
+// Runs the cycle image (tools/cycle_image) on a simulated cortex-m0+ and counts the cycles of every frame it marks,
+// so the core's cost on the pico can be measured and checked on any linux host without a board.
+//
+// usage: cycle_bench [-m miss_cycles] [-b baseline.txt] [-t percent] [-w] cycle_image.bin
+//        cycle_bench -p script.txt plugin.bin
+//
+// The image is a raw binary linked at the start of flash. Instructions take the cycles the cortex-m0+ manual gives
+// for the rp2040's configuration (single cycle multiplier, zero wait state sram). Code and constants in flash go
+// through a model of the 16kB xip cache, every miss adds miss_cycles (40 by default, 0 leaves the flash out). The
+// image talks to the simulator with bkpt, see tools/cycle_image/host_call.h.
+//
+// For every case the image runs it prints the frames, the mean and worst cycles per frame, the instructions and xip
+// misses per frame and the mean time at 125MHz. The run fails if a frame of a case with a known cost
+// (HOST_CALL_EXPECT) took any other number of cycles. tools/cycle_image/calibration.s is made of such cases.
+//
+// With -b the means are compared to a baseline file of "<case> <mean cycles>" lines ('#' starts a comment line) and
+// the run fails if one is more than percent (2 by default) over it. Cases that aren't in the file are listed and
+// pass, so new cases can land before their numbers are recorded. -w writes the file instead, a missing one is an
+// error.
+//
+// With -p a plugin image (see plugins/) runs instead, the way the plugin profile runs it. The size and checksum are
+// filled in like tools/plugin_upload does, the image has to pass the firmware's checks and is called from an sram
+// slot with the thumb bit of its entry. The script has the CHEATBOX_SCRIPT format, "<time_ms> <pin> <0|1>" per line,
+// played at one frame per ms. The api answers from the script and the report tick is the time in ms. Like on the
+// box the task only runs on frames where an input changed or it called request_update the frame before. Every
+// change of the virtual buttons it presses is printed as "<tick> <hex mask>". The plugin may only write its state
+// and the stack, and an api call leaves r1-r3 and r12 scrambled like a real one may. The cycles per call, which count
+// only the branches into and out of the api, go to stderr. The run fails if the plugin would be disabled for going
+// over PLUGIN_BUDGET_CYCLES.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/common.h"
+#include "src/settings.h"
+#include "src/plugin_abi.h"
+#include "tools/cycle_image/host_call.h"
+
+#define _FLASH_BASE 0x10000000u
+#define _FLASH_SIZE (2 * 1024 * 1024)
+#define _RAM_BASE 0x20000000u
+#define _RAM_SIZE (264 * 1024)
+
+// The xip cache: 2 ways of 1024 sets with 8 byte lines
+#define _XIP_SETS 1024
+#define _XIP_LINE 8
+
+// The sys clock the times are given for
+#define _CLOCK_MHZ 125
+
+// A frame that runs longer than this never ends
+#define _FRAME_LIMIT 100000000ull
+
+#define _MAX_CASES 32
+
+// Where -p puts the plugin and what it is called with, laid out as on armv6m
+#define _PLUGIN_STUBS (_RAM_BASE + 0x000)
+#define _PLUGIN_RETURN (_RAM_BASE + 0x100)
+#define _PLUGIN_API (_RAM_BASE + 0x200)
+#define _PLUGIN_PROFILE (_RAM_BASE + 0x300)
+#define _PLUGIN_CONTEXT (_RAM_BASE + 0x400)
+#define _PLUGIN_STATE (_PLUGIN_CONTEXT + 8)
+#define _PLUGIN_SLOT (_RAM_BASE + 0x1000)
+// The plugin shares the scan loop's stack, one that needs more than this faults
+#define _PLUGIN_STACK 1024
+// Frames played after the last event so plinks and timers settle
+#define _PLUGIN_TAIL_FRAMES 20
+// What an api call leaves in the registers it may clobber
+#define _SCRAMBLED 0xDEADBEEFu
+
+// The functions of PluginApi after abi_version, in order
+typedef enum {
+    _API_BUTTON_MASK,
+    _API_BUTTON_DOWN,
+    _API_BUTTON_UP,
+    _API_BUTTON_PRESSED,
+    _API_BUTTON_RELEASED,
+    _API_BOARD_BUTTON_DOWN,
+    _API_TIME_US,
+    _API_FRAME,
+    _API_REPORT_TICK,
+    _API_REQUEST_UPDATE,
+    _API_PRESS,
+    _API_RELEASE,
+    _API_TOGGLE,
+    _API_BIND,
+    _API_BIND_PINS,
+    _API_TURBO,
+    _API_DIRECTION,
+
+    _API_COUNT,
+} _ApiCall;
+
+// Every field is pointer sized on the host, abi_version included once padded
+_Static_assert(sizeof(PluginApi) == (_API_COUNT + 1) * sizeof(void *), "PluginApi changed, update _ApiCall");
+
+typedef struct {
+    char name[64];
+    u32 frames;
+    u64 cycles;
+    u64 max_cycles;
+    u64 instructions;
+    u64 misses;
+
+    // Cycles every frame must take without the xip misses, 0 if unknown
+    u64 expected;
+    u32 unexpected;
+} _Case;
+
+typedef struct {
+    u32 r[16];
+    bool n, z, c, v;
+
+    u64 cycles;
+    u64 instructions;
+    u64 misses;
+
+    bool halted;
+    u32 status;
+} _Cpu;
+
+static u8 *_flash = NULL;
+static u8 *_ram = NULL;
+
+static u32 _xip_tags[_XIP_SETS][2];
+static bool _xip_valid[_XIP_SETS][2];
+// Way to replace next in each set
+static u8 _xip_lru[_XIP_SETS];
+static u32 _miss_cycles = 40;
+
+static _Case _cases[_MAX_CASES];
+static int _case_count = 0;
+
+static bool _in_frame = false;
+static u64 _frame_cycles = 0;
+static u64 _frame_instructions = 0;
+static u64 _frame_misses = 0;
+
+typedef struct {
+    u32 time_us;
+    u8 pin;
+    bool down;
+} _Event;
+
+// Set while a plugin runs, its stores are checked and only its host calls are allowed
+static bool _plugin = false;
+static InputMask _held = 0;
+static InputMask _previous = 0;
+static u64 _output = 0;
+static u32 _tick = 0;
+static bool _update = false;
+
+static void _fault(const _Cpu *cpu, const char *what, u32 address) {
+    fprintf(stderr, "fault at pc %08x: %s %08x\n", cpu->r[15], what, address);
+    exit(1);
+}
+
+static void _xip_access(_Cpu *cpu, u32 address) {
+    u32 line = address / _XIP_LINE;
+    u32 set = line % _XIP_SETS;
+
+    for (int way = 0; way < 2; ++way) {
+        if (_xip_valid[set][way] && _xip_tags[set][way] == line) {
+            _xip_lru[set] = (u8) (1 - way);
+            return;
+        }
+    }
+
+    int way = _xip_lru[set];
+    _xip_tags[set][way] = line;
+    _xip_valid[set][way] = true;
+    _xip_lru[set] = (u8) (1 - way);
+
+    cpu->cycles += _miss_cycles;
+    cpu->misses += 1;
+}
+
+// Host memory behind a simulated access, faults on anything unmapped, unaligned or a write to flash
+static u8 *_memory(_Cpu *cpu, u32 address, u32 size, bool write) {
+    if (address & (size - 1)) _fault(cpu, "unaligned access to", address);
+
+    if (address - _FLASH_BASE < _FLASH_SIZE) {
+        if (write) _fault(cpu, "write to flash at", address);
+        _xip_access(cpu, address);
+        return _flash + (address - _FLASH_BASE);
+    }
+
+    if (address - _RAM_BASE < _RAM_SIZE) return _ram + (address - _RAM_BASE);
+
+    _fault(cpu, "access to unmapped", address);
+    return NULL;
+}
+
+static u32 _load(_Cpu *cpu, u32 address, u32 size) {
+    const u8 *p = _memory(cpu, address, size, false);
+    if (size == 1) return p[0];
+    if (size == 2) return p[0] | p[1] << 8;
+    return p[0] | p[1] << 8 | p[2] << 16 | (u32) p[3] << 24;
+}
+
+static void _store(_Cpu *cpu, u32 address, u32 size, u32 value) {
+    if (_plugin) {
+        bool state = address - _PLUGIN_STATE < PLUGIN_STATE_SIZE;
+        bool stack = address - (_RAM_BASE + _RAM_SIZE - _PLUGIN_STACK) < _PLUGIN_STACK;
+        if (!state && !stack) _fault(cpu, "plugin write outside its state and stack at", address);
+    }
+
+    u8 *p = _memory(cpu, address, size, true);
+    for (u32 i = 0; i < size; ++i) p[i] = (u8) (value >> (8 * i));
+}
+
+static u16 _fetch(_Cpu *cpu, u32 address) {
+    if (address - _FLASH_BASE >= _FLASH_SIZE && address - _RAM_BASE >= _RAM_SIZE) {
+        _fault(cpu, "execution from", address);
+    }
+    return (u16) _load(cpu, address, 2);
+}
+
+// Register operand, the pc reads as the instruction's address + 4
+static u32 _reg(const _Cpu *cpu, u32 n) {
+    return n == 15 ? cpu->r[15] + 4 : cpu->r[n];
+}
+
+static void _set_nz(_Cpu *cpu, u32 result) {
+    cpu->n = result >> 31;
+    cpu->z = result == 0;
+}
+
+static u32 _add(_Cpu *cpu, u32 a, u32 b, u32 carry, bool flags) {
+    u64 sum = (u64) a + b + carry;
+    u32 result = (u32) sum;
+
+    if (flags) {
+        _set_nz(cpu, result);
+        cpu->c = sum >> 32;
+        cpu->v = ((a ^ result) & (b ^ result)) >> 31;
+    }
+    return result;
+}
+
+static bool _condition(const _Cpu *cpu, u32 cond) {
+    switch (cond) {
+        case 0x0: return cpu->z;
+        case 0x1: return !cpu->z;
+        case 0x2: return cpu->c;
+        case 0x3: return !cpu->c;
+        case 0x4: return cpu->n;
+        case 0x5: return !cpu->n;
+        case 0x6: return cpu->v;
+        case 0x7: return !cpu->v;
+        case 0x8: return cpu->c && !cpu->z;
+        case 0x9: return !cpu->c || cpu->z;
+        case 0xA: return cpu->n == cpu->v;
+        case 0xB: return cpu->n != cpu->v;
+        case 0xC: return !cpu->z && cpu->n == cpu->v;
+        case 0xD: return cpu->z || cpu->n != cpu->v;
+    }
+    return true;
+}
+
+// LSL, LSR, ASR (kind 0, 1, 2) and ROR (3) by a register, which sets the carry to the last bit shifted out
+static u32 _shift(_Cpu *cpu, u32 kind, u32 value, u32 amount) {
+    u32 result = value;
+
+    if (amount == 0) {
+        // Nothing moves, the carry stays
+    }
+    else if (kind == 0) {
+        cpu->c = amount <= 32 && ((value >> (32 - amount)) & 1);
+        result = amount < 32 ? value << amount : 0;
+    }
+    else if (kind == 1) {
+        cpu->c = amount <= 32 && ((value >> (amount - 1)) & 1);
+        result = amount < 32 ? value >> amount : 0;
+    }
+    else if (kind == 2) {
+        if (amount >= 32) amount = 32;
+        cpu->c = (value >> (amount - 1)) & 1;
+        result = amount < 32 ? (u32) ((i32) value >> amount) : (u32) ((i32) value >> 31);
+    }
+    else {
+        amount &= 31;
+        if (amount) result = value >> amount | value << (32 - amount);
+        cpu->c = result >> 31;
+    }
+
+    _set_nz(cpu, result);
+    return result;
+}
+
+static bool _pin(InputMask mask, u32 index) {
+    return index < INPUT_COUNT && (mask & INPUT_BIT(index));
+}
+
+static u64 _virtual(const _Cpu *cpu, u32 button) {
+    if (button >= VIRTUAL_BUTTON_COUNT) _fault(cpu, "plugin used virtual button", button);
+    return 1ull << button;
+}
+
+// Answers the api call of the stub at the pc from the script
+static void _plugin_api(_Cpu *cpu) {
+    u32 call = (cpu->r[15] - _PLUGIN_STUBS) / 4;
+    u32 *r = cpu->r;
+    bool wide = false;
+
+    switch (call) {
+        case _API_BUTTON_MASK:
+            r[0] = (u32) _held;
+            r[1] = (u32) (_held >> 32);
+            wide = true;
+            break;
+        case _API_BUTTON_DOWN:        r[0] = _pin(_held, r[0]); break;
+        case _API_BUTTON_UP:          r[0] = !_pin(_held, r[0]); break;
+        case _API_BUTTON_PRESSED:     r[0] = _pin(_held & ~_previous, r[0]); break;
+        case _API_BUTTON_RELEASED:    r[0] = _pin(~_held & _previous, r[0]); break;
+        case _API_BOARD_BUTTON_DOWN:  r[0] = false; break;
+        case _API_TIME_US:            r[0] = _tick * 1000; break;
+        case _API_FRAME:
+        case _API_REPORT_TICK:        r[0] = _tick; break;
+        case _API_REQUEST_UPDATE:     _update = true; break;
+        case _API_PRESS:              _output |= _virtual(cpu, r[0]); break;
+        case _API_RELEASE:            _output &= ~_virtual(cpu, r[0]); break;
+        case _API_TOGGLE:             _output ^= _virtual(cpu, r[0]); break;
+        case _API_BIND:               if (_pin(_held, r[0])) _output |= _virtual(cpu, r[1]); break;
+        // The pins come in r0 and r1
+        case _API_BIND_PINS:          if (r[0] | r[1]) _output |= _virtual(cpu, r[2]); break;
+        default:                      _fault(cpu, "plugin api call cycle_bench doesn't simulate, number", call);
+    }
+
+    if (!wide) r[1] = _SCRAMBLED;
+    r[2] = r[3] = r[12] = _SCRAMBLED;
+}
+
+static void _host_call(_Cpu *cpu, u32 call) {
+    if (_plugin) {
+        if (call == HOST_CALL_PLUGIN_API && cpu->r[15] - _PLUGIN_STUBS < _API_COUNT * 4) {
+            _plugin_api(cpu);
+            return;
+        }
+        if (call == HOST_CALL_PLUGIN_RETURN && cpu->r[15] == _PLUGIN_RETURN) {
+            cpu->halted = true;
+            return;
+        }
+        _fault(cpu, "host call from a plugin, call", call);
+    }
+
+    switch (call) {
+        case HOST_CALL_EXIT:
+            cpu->halted = true;
+            cpu->status = cpu->r[0];
+            return;
+
+        case HOST_CALL_CASE: {
+            if (_case_count == _MAX_CASES) _fault(cpu, "too many cases, case", _case_count);
+            _Case *current = &_cases[_case_count++];
+            memset(current, 0, sizeof(*current));
+
+            u32 address = cpu->r[0];
+            for (size_t i = 0; i + 1 < sizeof(current->name); ++i) {
+                char c = (char) _load(cpu, address + (u32) i, 1);
+                if (!c) break;
+                current->name[i] = c;
+            }
+            return;
+        }
+
+        case HOST_CALL_FRAME_BEGIN:
+            _in_frame = true;
+            _frame_cycles = cpu->cycles;
+            _frame_instructions = cpu->instructions;
+            _frame_misses = cpu->misses;
+            return;
+
+        case HOST_CALL_FRAME_END: {
+            if (!_in_frame || _case_count == 0) _fault(cpu, "frame end without a frame, call", call);
+            _in_frame = false;
+
+            _Case *current = &_cases[_case_count - 1];
+            u64 cycles = cpu->cycles - _frame_cycles;
+            current->frames += 1;
+            current->cycles += cycles;
+            current->instructions += cpu->instructions - _frame_instructions;
+            current->misses += cpu->misses - _frame_misses;
+            if (cycles > current->max_cycles) current->max_cycles = cycles;
+
+            u64 misses = cpu->misses - _frame_misses;
+            if (current->expected && cycles - misses * _miss_cycles != current->expected) current->unexpected += 1;
+            return;
+        }
+
+        case HOST_CALL_EXPECT:
+            if (_case_count == 0) _fault(cpu, "expected cycles without a case, call", call);
+            _cases[_case_count - 1].expected = cpu->r[0];
+            return;
+    }
+
+    _fault(cpu, "unknown host call", call);
+}
+
+// Executes one instruction and adds its cycles
+static void _step(_Cpu *cpu) {
+    u32 pc = cpu->r[15];
+    u32 op = _fetch(cpu, pc);
+    u32 next = pc + 2;
+    u32 cycles = 1;
+    // Host calls aren't part of the code being measured
+    bool host = false;
+
+    u32 rd = op & 7;
+    u32 rn = (op >> 3) & 7;
+    u32 rm = (op >> 6) & 7;
+    u32 imm5 = (op >> 6) & 31;
+    u32 high = (op >> 8) & 7;
+    u32 imm8 = op & 0xFF;
+
+    switch (op >> 11) {
+        case 0x00:
+            // LSL with 0 is MOV, it leaves the carry alone
+            if (imm5) cpu->r[rd] = _shift(cpu, 0, cpu->r[rn], imm5);
+            else {
+                cpu->r[rd] = cpu->r[rn];
+                _set_nz(cpu, cpu->r[rd]);
+            }
+            break;
+        case 0x01: cpu->r[rd] = _shift(cpu, 1, cpu->r[rn], imm5 ? imm5 : 32); break;
+        case 0x02: cpu->r[rd] = _shift(cpu, 2, cpu->r[rn], imm5 ? imm5 : 32); break;
+
+        case 0x03: {
+            u32 operand = op & 0x400 ? rm : cpu->r[rm];
+            if (op & 0x200) cpu->r[rd] = _add(cpu, cpu->r[rn], ~operand, 1, true);
+            else cpu->r[rd] = _add(cpu, cpu->r[rn], operand, 0, true);
+            break;
+        }
+
+        case 0x04:
+            cpu->r[high] = imm8;
+            _set_nz(cpu, imm8);
+            break;
+        case 0x05: _add(cpu, cpu->r[high], ~imm8, 1, true); break;
+        case 0x06: cpu->r[high] = _add(cpu, cpu->r[high], imm8, 0, true); break;
+        case 0x07: cpu->r[high] = _add(cpu, cpu->r[high], ~imm8, 1, true); break;
+
+        case 0x08:
+            if (!(op & 0x400)) {
+                u32 a = cpu->r[rd];
+                u32 b = cpu->r[rn];
+                u32 result;
+
+                switch ((op >> 6) & 15) {
+                    case 0x0: result = cpu->r[rd] = a & b; _set_nz(cpu, result); break;
+                    case 0x1: result = cpu->r[rd] = a ^ b; _set_nz(cpu, result); break;
+                    case 0x2: cpu->r[rd] = _shift(cpu, 0, a, b & 0xFF); break;
+                    case 0x3: cpu->r[rd] = _shift(cpu, 1, a, b & 0xFF); break;
+                    case 0x4: cpu->r[rd] = _shift(cpu, 2, a, b & 0xFF); break;
+                    case 0x5: cpu->r[rd] = _add(cpu, a, b, cpu->c, true); break;
+                    case 0x6: cpu->r[rd] = _add(cpu, a, ~b, cpu->c, true); break;
+                    case 0x7: cpu->r[rd] = _shift(cpu, 3, a, b & 0xFF); break;
+                    case 0x8: _set_nz(cpu, a & b); break;
+                    case 0x9: cpu->r[rd] = _add(cpu, 0, ~b, 1, true); break;
+                    case 0xA: _add(cpu, a, ~b, 1, true); break;
+                    case 0xB: _add(cpu, a, b, 0, true); break;
+                    case 0xC: result = cpu->r[rd] = a | b; _set_nz(cpu, result); break;
+                    case 0xD: result = cpu->r[rd] = a * b; _set_nz(cpu, result); break;
+                    case 0xE: result = cpu->r[rd] = a & ~b; _set_nz(cpu, result); break;
+                    case 0xF: result = cpu->r[rd] = ~b; _set_nz(cpu, result); break;
+                }
+                break;
+            }
+
+            // High registers and branches through a register
+            {
+                u32 d = (op >> 4 & 8) | rd;
+                u32 m = (op >> 3) & 15;
+
+                switch ((op >> 8) & 3) {
+                    case 0: {
+                        u32 result = _reg(cpu, d) + _reg(cpu, m);
+                        if (d == 15) {
+                            next = result & ~1u;
+                            cycles = 2;
+                        }
+                        else cpu->r[d] = result;
+                        break;
+                    }
+                    case 1: _add(cpu, _reg(cpu, d), ~_reg(cpu, m), 1, true); break;
+                    case 2:
+                        if (d == 15) {
+                            next = _reg(cpu, m) & ~1u;
+                            cycles = 2;
+                        }
+                        else cpu->r[d] = _reg(cpu, m);
+                        break;
+                    case 3: {
+                        u32 target = _reg(cpu, m);
+                        if (!(target & 1)) _fault(cpu, "branch to arm state at", target);
+                        if (op & 0x80) cpu->r[14] = next | 1;
+                        next = target & ~1u;
+                        cycles = 2;
+                        break;
+                    }
+                }
+            }
+            break;
+
+        case 0x09:
+            cpu->r[high] = _load(cpu, ((pc + 4) & ~3u) + imm8 * 4, 4);
+            cycles = 2;
+            break;
+
+        case 0x0A:
+        case 0x0B: {
+            u32 address = cpu->r[rn] + cpu->r[rm];
+            switch ((op >> 9) & 7) {
+                case 0: _store(cpu, address, 4, cpu->r[rd]); break;
+                case 1: _store(cpu, address, 2, cpu->r[rd]); break;
+                case 2: _store(cpu, address, 1, cpu->r[rd]); break;
+                case 3: cpu->r[rd] = (u32) (i32) (i8) _load(cpu, address, 1); break;
+                case 4: cpu->r[rd] = _load(cpu, address, 4); break;
+                case 5: cpu->r[rd] = _load(cpu, address, 2); break;
+                case 6: cpu->r[rd] = _load(cpu, address, 1); break;
+                case 7: cpu->r[rd] = (u32) (i32) (i16) _load(cpu, address, 2); break;
+            }
+            cycles = 2;
+            break;
+        }
+
+        case 0x0C: _store(cpu, cpu->r[rn] + imm5 * 4, 4, cpu->r[rd]); cycles = 2; break;
+        case 0x0D: cpu->r[rd] = _load(cpu, cpu->r[rn] + imm5 * 4, 4); cycles = 2; break;
+        case 0x0E: _store(cpu, cpu->r[rn] + imm5, 1, cpu->r[rd]); cycles = 2; break;
+        case 0x0F: cpu->r[rd] = _load(cpu, cpu->r[rn] + imm5, 1); cycles = 2; break;
+        case 0x10: _store(cpu, cpu->r[rn] + imm5 * 2, 2, cpu->r[rd]); cycles = 2; break;
+        case 0x11: cpu->r[rd] = _load(cpu, cpu->r[rn] + imm5 * 2, 2); cycles = 2; break;
+        case 0x12: _store(cpu, cpu->r[13] + imm8 * 4, 4, cpu->r[high]); cycles = 2; break;
+        case 0x13: cpu->r[high] = _load(cpu, cpu->r[13] + imm8 * 4, 4); cycles = 2; break;
+        case 0x14: cpu->r[high] = ((pc + 4) & ~3u) + imm8 * 4; break;
+        case 0x15: cpu->r[high] = cpu->r[13] + imm8 * 4; break;
+
+        case 0x16:
+        case 0x17:
+            if ((op & 0xFF00) == 0xB000) {
+                u32 offset = (op & 0x7F) * 4;
+                cpu->r[13] = op & 0x80 ? cpu->r[13] - offset : cpu->r[13] + offset;
+            }
+            else if ((op & 0xFF00) == 0xB200) {
+                u32 value = cpu->r[rn];
+                switch ((op >> 6) & 3) {
+                    case 0: cpu->r[rd] = (u32) (i32) (i16) value; break;
+                    case 1: cpu->r[rd] = (u32) (i32) (i8) value; break;
+                    case 2: cpu->r[rd] = value & 0xFFFF; break;
+                    case 3: cpu->r[rd] = value & 0xFF; break;
+                }
+            }
+            else if ((op & 0xFE00) == 0xB400) {
+                u32 list = (op & 0xFF) | (op & 0x100 ? 1u << 14 : 0);
+                u32 address = cpu->r[13] - 4 * (u32) __builtin_popcount(list);
+                cpu->r[13] = address;
+                for (u32 i = 0; i < 15; ++i) {
+                    if (!(list & (1u << i))) continue;
+                    _store(cpu, address, 4, cpu->r[i]);
+                    address += 4;
+                    cycles += 1;
+                }
+            }
+            else if ((op & 0xFFE8) == 0xB660) {
+                // CPS, there are no interrupts to mask
+            }
+            else if ((op & 0xFF00) == 0xBA00 && ((op >> 6) & 3) != 2) {
+                u32 value = cpu->r[rn];
+                switch ((op >> 6) & 3) {
+                    case 0: cpu->r[rd] = __builtin_bswap32(value); break;
+                    case 1: cpu->r[rd] = (value & 0xFF00FF00) >> 8 | (value & 0x00FF00FF) << 8; break;
+                    case 3: cpu->r[rd] = (u32) (i32) (i16) (u16) (value << 8 | (value >> 8 & 0xFF)); break;
+                }
+            }
+            else if ((op & 0xFE00) == 0xBC00) {
+                u32 address = cpu->r[13];
+                for (u32 i = 0; i < 8; ++i) {
+                    if (!(op & (1u << i))) continue;
+                    cpu->r[i] = _load(cpu, address, 4);
+                    address += 4;
+                    cycles += 1;
+                }
+                if (op & 0x100) {
+                    u32 target = _load(cpu, address, 4);
+                    address += 4;
+                    if (!(target & 1)) _fault(cpu, "return to arm state at", target);
+                    next = target & ~1u;
+                    cycles += 3;
+                }
+                cpu->r[13] = address;
+            }
+            else if ((op & 0xFF00) == 0xBE00) {
+                _host_call(cpu, imm8);
+                host = true;
+            }
+            else if ((op & 0xFF0F) == 0xBF00) {
+                // NOP, YIELD, WFE, WFI and SEV
+            }
+            else {
+                _fault(cpu, "undefined instruction", op);
+            }
+            break;
+
+        case 0x18:
+        case 0x19: {
+            u32 address = cpu->r[high];
+            bool load = op & 0x800;
+            for (u32 i = 0; i < 8; ++i) {
+                if (!(op & (1u << i))) continue;
+                if (load) cpu->r[i] = _load(cpu, address, 4);
+                else _store(cpu, address, 4, cpu->r[i]);
+                address += 4;
+                cycles += 1;
+            }
+            // A load into the base register replaces the write back
+            if (!load || !(op & (1u << high))) cpu->r[high] = address;
+            break;
+        }
+
+        case 0x1A:
+        case 0x1B: {
+            u32 cond = (op >> 8) & 15;
+            if (cond >= 0xE) _fault(cpu, cond == 0xF ? "svc" : "udf", op);
+            if (_condition(cpu, cond)) {
+                next = pc + 4 + (u32) ((i32) (i8) imm8 * 2);
+                cycles = 2;
+            }
+            break;
+        }
+
+        case 0x1C:
+            next = pc + 4 + (u32) (((i32) (op << 21)) >> 20);
+            cycles = 2;
+            break;
+
+        case 0x1E:
+        case 0x1F: {
+            u32 op2 = _fetch(cpu, pc + 2);
+            next = pc + 4;
+
+            if ((op & 0xF800) == 0xF000 && (op2 & 0xD000) == 0xD000) {
+                u32 s = (op >> 10) & 1;
+                u32 i1 = !(((op2 >> 13) & 1) ^ s);
+                u32 i2 = !(((op2 >> 11) & 1) ^ s);
+                u32 offset = s << 24 | i1 << 23 | i2 << 22 | (op & 0x3FF) << 12 | (op2 & 0x7FF) << 1;
+                cpu->r[14] = next | 1;
+                next = next + (u32) (((i32) (offset << 7)) >> 7);
+                cycles = 3;
+            }
+            else if (op == 0xF3BF && (op2 & 0xFF00) == 0x8F00) {
+                // DSB, DMB and ISB
+                cycles = 3;
+            }
+            else {
+                _fault(cpu, "unsupported instruction", op << 16 | op2);
+            }
+            break;
+        }
+
+        default:
+            _fault(cpu, "undefined instruction", op);
+    }
+
+    cpu->r[15] = next;
+    if (host) return;
+
+    cpu->cycles += cycles;
+    cpu->instructions += 1;
+
+    if (_in_frame && cpu->cycles - _frame_cycles > _FRAME_LIMIT) _fault(cpu, "frame never ended, cycle", 0);
+}
+
+static bool _load_image(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+
+    size_t size = fread(_flash, 1, _FLASH_SIZE, file);
+    bool more = fgetc(file) != EOF;
+    fclose(file);
+
+    if (size < 8 || more) {
+        fprintf(stderr, "%s: not a cycle image\n", path);
+        return false;
+    }
+    return true;
+}
+
+// Mean cycles per frame of a case in the baseline, -1 if it isn't there
+static double _baseline_mean(FILE *file, const char *name) {
+    char line[256];
+    rewind(file);
+
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#') continue;
+
+        char case_name[64];
+        double mean;
+        if (sscanf(line, "%63s %lf", case_name, &mean) == 2 && strcmp(case_name, name) == 0) return mean;
+    }
+    return -1;
+}
+
+static bool _write_baseline(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+
+    fprintf(file, "# Mean cycles per frame of every case of the cycle image, written by cycle_bench -w\n");
+    for (int i = 0; i < _case_count; ++i) {
+        const _Case *current = &_cases[i];
+        fprintf(file, "%s %.1f\n", current->name, current->frames ? (double) current->cycles / current->frames : 0.0);
+    }
+
+    fclose(file);
+    printf("baseline written to %s\n", path);
+    return true;
+}
+
+static _Event *_load_script(const char *path, size_t *count) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return NULL;
+    }
+
+    _Event *events = NULL;
+    size_t capacity = 0;
+    char line[256];
+    *count = 0;
+
+    while (fgets(line, sizeof(line), file)) {
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        double time_ms;
+        int pin, down;
+        int fields = sscanf(line, "%lf %d %d", &time_ms, &pin, &down);
+        if (fields <= 0) continue;
+        if (fields != 3 || pin < 0 || pin >= INPUT_COUNT || time_ms < 0) continue;
+
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            events = realloc(events, capacity * sizeof(*events));
+        }
+        events[(*count)++] = (_Event) { (u32) (time_ms * 1000.0), (u8) pin, down != 0 };
+    }
+
+    fclose(file);
+    if (*count == 0) fprintf(stderr, "%s: no events\n", path);
+    return events;
+}
+
+static int _run_plugin(const char *script, const char *path) {
+    size_t event_count;
+    _Event *events = _load_script(script, &event_count);
+    if (!events || event_count == 0) return 1;
+
+    static u8 image[PLUGIN_MAX_SIZE + 1];
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return 1;
+    }
+    u32 size = (u32) fread(image, 1, sizeof(image), file);
+    fclose(file);
+
+    // What tools/plugin_upload sends
+    PluginHeader *header = (PluginHeader *) image;
+    if (size >= sizeof(PluginHeader)) {
+        header->size = size;
+        header->checksum = plugin_checksum(image, size);
+    }
+
+    PluginImageCheck check = plugin_check_image(image, size, PLUGIN_MAX_SIZE, PLUGIN_ARCH_ARMV6M);
+    if (check != PLUGIN_IMAGE_OK) {
+        fprintf(stderr, "%s: the firmware would refuse it as %s\n", path,
+                check == PLUGIN_IMAGE_UNSUPPORTED ? "unsupported" : "invalid");
+        return 1;
+    }
+
+    _Cpu cpu = {0};
+    memcpy(_ram + (_PLUGIN_SLOT - _RAM_BASE), image, size);
+    for (u32 i = 0; i < _API_COUNT; ++i) {
+        _store(&cpu, _PLUGIN_STUBS + i * 4, 2, 0xBE00 | HOST_CALL_PLUGIN_API);
+        _store(&cpu, _PLUGIN_STUBS + i * 4 + 2, 2, 0x4770);
+        _store(&cpu, _PLUGIN_API + 4 + i * 4, 4, (_PLUGIN_STUBS + i * 4) | 1);
+    }
+    _store(&cpu, _PLUGIN_RETURN, 2, 0xBE00 | HOST_CALL_PLUGIN_RETURN);
+    _store(&cpu, _PLUGIN_API, 4, PLUGIN_ABI_VERSION);
+    _store(&cpu, _PLUGIN_PROFILE + PLUGIN_PROFILE_STATE_OFFSET, 4, _PLUGIN_CONTEXT);
+    _store(&cpu, _PLUGIN_CONTEXT, 4, _PLUGIN_API);
+    _store(&cpu, _PLUGIN_CONTEXT + 4, 4, 1);
+
+    fprintf(stderr, "%.16s: entry %#x, %u bytes of state\n", header->name, header->entry, header->state_size);
+
+    u32 frames = events[event_count - 1].time_us / 1000 + _PLUGIN_TAIL_FRAMES;
+    size_t next = 0;
+    bool dirty = true;
+    u64 printed = 0;
+    u32 runs = 0;
+    u32 consecutive = 0;
+    u64 total = 0;
+    u64 max = 0;
+
+    _plugin = true;
+    for (_tick = 0; _tick < frames; ++_tick) {
+        while (next < event_count && events[next].time_us <= _tick * 1000) {
+            if (events[next].down) _held |= INPUT_BIT(events[next].pin);
+            else _held &= ~INPUT_BIT(events[next].pin);
+            next += 1;
+        }
+
+        if (dirty || _held != _previous) {
+            // The trampoline releases everything before the call
+            _output = 0;
+            _update = false;
+
+            cpu.r[0] = _PLUGIN_PROFILE;
+            cpu.r[13] = _RAM_BASE + _RAM_SIZE;
+            cpu.r[14] = _PLUGIN_RETURN | 1;
+            u32 entry = _PLUGIN_SLOT + header->entry;
+            if (!(entry & 1)) _fault(&cpu, "branch to arm state at", entry);
+            cpu.r[15] = entry & ~1u;
+            cpu.halted = false;
+
+            u64 start = cpu.cycles;
+            while (!cpu.halted) {
+                _step(&cpu);
+                if (cpu.cycles - start > _FRAME_LIMIT) _fault(&cpu, "the plugin never returned, frame", _tick);
+            }
+
+            u64 cycles = cpu.cycles - start;
+            runs += 1;
+            total += cycles;
+            if (cycles > max) max = cycles;
+            consecutive = cycles > PLUGIN_BUDGET_CYCLES ? consecutive + 1 : 0;
+            if (consecutive >= PLUGIN_MAX_OVERRUNS) {
+                fprintf(stderr, "disabled at tick %u, over %d cycles for %d frames in a row\n", _tick,
+                        PLUGIN_BUDGET_CYCLES, PLUGIN_MAX_OVERRUNS);
+                return 2;
+            }
+            dirty = _update;
+        }
+
+        if (_output != printed) {
+            printf("%u %016llx\n", _tick, (unsigned long long) _output);
+            printed = _output;
+        }
+        _previous = _held;
+    }
+    _plugin = false;
+
+    fprintf(stderr, "%u of %u frames ran the task, mean %.1f max %llu cycles, budget %d\n", runs, frames,
+            runs ? (double) total / runs : 0.0, (unsigned long long) max, PLUGIN_BUDGET_CYCLES);
+    free(events);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *baseline = NULL;
+    const char *script = NULL;
+    double threshold = 2.0;
+    bool write = false;
+
+    int arg = 1;
+    while (arg < argc && argv[arg][0] == '-') {
+        if (strcmp(argv[arg], "-w") == 0) {
+            write = true;
+            arg += 1;
+            continue;
+        }
+        if (arg + 1 >= argc) break;
+
+        if (strcmp(argv[arg], "-m") == 0)      _miss_cycles = (u32) atoi(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-b") == 0) baseline = argv[arg + 1];
+        else if (strcmp(argv[arg], "-t") == 0) threshold = atof(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-p") == 0) script = argv[arg + 1];
+        else break;
+        arg += 2;
+    }
+
+    if (arg != argc - 1 || threshold < 0 || (write && !baseline) || (script && baseline)) {
+        fprintf(stderr, "usage: %s [-m miss_cycles] [-b baseline.txt] [-t percent] [-w] cycle_image.bin\n", argv[0]);
+        fprintf(stderr, "       %s -p script.txt plugin.bin\n", argv[0]);
+        return 1;
+    }
+
+    _flash = calloc(1, _FLASH_SIZE);
+    _ram = calloc(1, _RAM_SIZE);
+    if (script) return _run_plugin(script, argv[arg]);
+    if (!_load_image(argv[arg])) return 1;
+
+    // The vector table holds the initial stack pointer and the reset handler
+    _Cpu cpu = {0};
+    cpu.r[13] = _flash[0] | _flash[1] << 8 | _flash[2] << 16 | (u32) _flash[3] << 24;
+    cpu.r[15] = (_flash[4] | _flash[5] << 8 | _flash[6] << 16 | (u32) _flash[7] << 24) & ~1u;
+
+    while (!cpu.halted) _step(&cpu);
+
+    if (cpu.status != 0) {
+        fprintf(stderr, "the image exited with %u\n", cpu.status);
+        return 1;
+    }
+    if (_case_count == 0) {
+        fprintf(stderr, "the image ran no cases\n");
+        return 1;
+    }
+
+    printf("%-24s %7s %10s %8s %12s %10s %8s\n", "case", "frames", "mean", "max", "instructions", "xip misses",
+           "mean us");
+    for (int i = 0; i < _case_count; ++i) {
+        const _Case *current = &_cases[i];
+        double frames = current->frames ? current->frames : 1;
+        double mean = current->cycles / frames;
+
+        printf("%-24s %7u %10.1f %8llu %12.1f %10.2f %8.2f\n", current->name, current->frames, mean,
+               (unsigned long long) current->max_cycles, current->instructions / frames, current->misses / frames,
+               mean / _CLOCK_MHZ);
+    }
+    printf("%llu cycles, %llu instructions in total\n", (unsigned long long) cpu.cycles,
+           (unsigned long long) cpu.instructions);
+
+    int wrong = 0;
+    for (int i = 0; i < _case_count; ++i) {
+        const _Case *current = &_cases[i];
+        if (!current->expected) continue;
+
+        printf("%-24s expected %llu cycles, %u of %u frames differ\n", current->name,
+               (unsigned long long) current->expected, current->unexpected, current->frames);
+        wrong += current->unexpected > 0;
+    }
+    if (wrong) {
+        fprintf(stderr, "the simulator got %d cases with a known cost wrong\n", wrong);
+        return 2;
+    }
+
+    if (!baseline) return 0;
+    if (write) return _write_baseline(baseline) ? 0 : 1;
+
+    FILE *file = fopen(baseline, "r");
+    if (!file) {
+        if (errno == ENOENT) fprintf(stderr, "%s doesn't exist, record it with -w\n", baseline);
+        else perror(baseline);
+        return 1;
+    }
+
+    int regressions = 0;
+    int unrecorded = 0;
+    printf("\nagainst %s, %.1f%% allowed:\n", baseline, threshold);
+    for (int i = 0; i < _case_count; ++i) {
+        const _Case *current = &_cases[i];
+        double mean = current->frames ? (double) current->cycles / current->frames : 0.0;
+        double base = _baseline_mean(file, current->name);
+
+        // Nothing to compare with until the baseline is recorded again
+        if (base < 0) {
+            printf("%-24s %10s %10.1f  NOT IN BASELINE\n", current->name, "", mean);
+            unrecorded += 1;
+            continue;
+        }
+
+        double change = base > 0 ? (mean - base) * 100.0 / base : 0.0;
+        bool regressed = change > threshold;
+        regressions += regressed;
+        printf("%-24s %10.1f %10.1f %+7.2f%%%s\n", current->name, base, mean, change, regressed ? "  REGRESSED" : "");
+    }
+    fclose(file);
+
+    if (unrecorded) printf("%d cases not in the baseline, record them with -w\n", unrecorded);
+    printf("%s\n", regressions ? "FAIL" : "PASS");
+    return regressions ? 2 : 0;
+}
@@ -0,0 +1,117 @@
+@ Hand written cases with a known cost for cycle_bench, so the simulator's instruction timings are checked against the
+@ cortex-m0+ manual rather than against themselves. Every case runs its body as 4 frames and tells cycle_bench how
+@ many cycles each must take. Each frame is its own copy of the body, so every frame also fetches new code from
+@ flash, which cycle_bench leaves out of the comparison and shows as xip misses.
+@
+@ calibration.bin is checked in so the test runs without an arm toolchain. To rebuild it:
+@     arm-none-eabi-as -mcpu=cortex-m0plus calibration.s -o calibration.o
+@     arm-none-eabi-ld -Ttext=0x10000000 -e reset calibration.o -o calibration.elf
+@     arm-none-eabi-objcopy -O binary calibration.elf calibration.bin
+
+    .syntax unified
+    .cpu cortex-m0plus
+    .thumb
+
+@ host_call.h
+    .equ HOST_CALL_EXIT, 0
+    .equ HOST_CALL_CASE, 1
+    .equ HOST_CALL_FRAME_BEGIN, 2
+    .equ HOST_CALL_FRAME_END, 3
+    .equ HOST_CALL_EXPECT, 4
+
+    .equ RAM, 0x20000000
+    .equ FRAMES, 4
+
+    .macro start_case name, cycles
+    ldr r0, =\name
+    bkpt #HOST_CALL_CASE
+    ldr r0, =\cycles
+    bkpt #HOST_CALL_EXPECT
+    .endm
+
+    .text
+vectors:
+    .word RAM + 0x1000
+    .word reset
+
+    .global reset
+    .thumb_func
+reset:
+    ldr r6, =RAM
+
+    @ Data processing and the single cycle multiplier, 1 cycle each
+    start_case name_alu, 8
+    .rept FRAMES
+    bkpt #HOST_CALL_FRAME_BEGIN
+    movs r1, #3
+    adds r1, r1, #2
+    lsls r1, r1, #4
+    muls r1, r1, r1
+    eors r1, r1
+    mov r2, r1
+    cmp r1, r2
+    rev r3, r1
+    bkpt #HOST_CALL_FRAME_END
+    .endr
+
+    @ Single loads and stores 2, multiple 1 + registers
+    start_case name_memory, 18
+    .rept FRAMES
+    bkpt #HOST_CALL_FRAME_BEGIN
+    str r1, [r6]            @ 2
+    ldr r2, [r6]            @ 2
+    strb r1, [r6, #4]       @ 2
+    ldrh r2, [r6, #4]       @ 2
+    mov r5, r6              @ 1
+    stmia r5!, {r1, r2}     @ 3
+    subs r5, #8             @ 1
+    ldmia r5!, {r1, r2}     @ 3
+    ldr r3, [sp, #0]        @ 2
+    bkpt #HOST_CALL_FRAME_END
+    .endr
+
+    @ Conditional branches 2 taken and 1 not, b 2: 1 + 5 + 4 * 2 + 1 + 2
+    start_case name_branch, 17
+    .rept FRAMES
+    bkpt #HOST_CALL_FRAME_BEGIN
+    movs r1, #5
+1:
+    subs r1, #1
+    bne 1b
+    b 2f
+2:
+    bkpt #HOST_CALL_FRAME_END
+    .endr
+
+    @ bl 3, bx 2, push 1 + registers, pop with pc 3 + registers: 3 + 2 + 3 + 3 + 1 + 5
+    start_case name_call, 17
+    .rept FRAMES
+    bkpt #HOST_CALL_FRAME_BEGIN
+    bl leaf
+    bl nested
+    bkpt #HOST_CALL_FRAME_END
+    .endr
+
+    movs r0, #0
+    bkpt #HOST_CALL_EXIT
+
+    .thumb_func
+leaf:
+    bx lr
+
+    .thumb_func
+nested:
+    push {r4, lr}
+    movs r4, #1
+    pop {r4, pc}
+
+    .ltorg
+
+name_alu:
+    .asciz "calibration/alu"
+name_memory:
+    .asciz "calibration/memory"
+name_branch:
+    .asciz "calibration/branch"
+name_call:
+    .asciz "calibration/call"
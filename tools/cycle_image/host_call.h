@@ -0,0 +1,20 @@
+#pragma once
+
+// Calls from the cycle image to tools/cycle_bench, made with "bkpt <call>" and the argument in r0. They take no
+// cycles and don't count as instructions.
+
+// Ends the run, r0 is the exit status
+#define HOST_CALL_EXIT 0
+// Starts a case, r0 points to its name. The frames after it belong to the case.
+#define HOST_CALL_CASE 1
+// The cycles between these two are one frame of the current case
+#define HOST_CALL_FRAME_BEGIN 2
+#define HOST_CALL_FRAME_END 3
+// Every later frame of the current case must take r0 cycles, xip misses left out. Checks the simulator itself.
+#define HOST_CALL_EXPECT 4
+
+// Planted by cycle_bench itself around a plugin it runs (-p), images don't use these.
+// Every api function of the plugin is "bkpt PLUGIN_API; bx lr", the call is told apart by its address.
+#define HOST_CALL_PLUGIN_API 5
+// The return address the plugin task is called with
+#define HOST_CALL_PLUGIN_RETURN 6
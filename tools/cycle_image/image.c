@@ -0,0 +1,195 @@
+// The firmware core as a bare cortex-m0+ image for tools/cycle_bench. Every profile plays the same generated input
+// in both modes and with every socd setting, and each scan is marked as one frame for the simulator. The backend is
+// replaced by a simulated scan clock, as in tools/pipeline_bench.
+
+#include "src/common.h"
+#include "src/settings.h"
+#include "src/profile.h"
+#include "src/profiles/default.h"
+#include "src/profiles/ggst.h"
+#include "src/platform/board.h"
+#include "src/platform/device.h"
+#include "src/platform/storage.h"
+
+#include "host_call.h"
+
+// Frames measured in every case, after the warm up frames that fill the xip cache
+#define _FRAMES 2000
+#define _WARMUP_FRAMES 200
+// The generator presses the board's buttons below MOD, so no hotkey ever fires
+#define _INPUT_PINS BUTTON_MOD
+#define _SCAN_US (POLLING_RATE * 1000)
+
+#define _HOST_CALL(call, arg) do { \
+        register u32 r0 __asm("r0") = (u32) (uintptr_t) (arg); \
+        __asm volatile ("bkpt %[n]" : : [n] "i" (call), "r" (r0) : "memory"); \
+    } while (0)
+
+// From image.ld
+extern u32 __data_load[], __data_start[], __data_end[], __bss_start[], __bss_end[], __stack_top[];
+extern void (*__init_array_start[])(void);
+extern void (*__init_array_end[])(void);
+
+int main(void);
+void reset_handler(void);
+
+// Only the stack pointer and the reset handler, nothing raises an exception
+__attribute__((section(".vectors"), used))
+static const void *const _vectors[2] = { __stack_top, (const void *) reset_handler };
+
+static u32 _now_us = 0;
+static Profile *_profile = NULL;
+
+static const char *const _mode_names[] = {
+    [MODE_KEYBOARD] = "keyboard",
+    [MODE_GAMEPAD] = "gamepad",
+};
+
+static const char *const _socd_names[] = {
+    [SOCD_NATURAL] = "natural",
+    [SOCD_NEUTRAL] = "neutral",
+    [SOCD_ABSOLUTE] = "absolute",
+    [SOCD_LAST_INPUT] = "last_input",
+};
+
+void reset_handler(void) {
+    for (u32 *from = __data_load, *to = __data_start; to < __data_end;) *to++ = *from++;
+    for (u32 *to = __bss_start; to < __bss_end;) *to++ = 0;
+    for (void (**init)(void) = __init_array_start; init < __init_array_end; ++init) (*init)();
+
+    _HOST_CALL(HOST_CALL_EXIT, main());
+    for (;;);
+}
+
+// The simulated backend
+u32 backend_time_us(void) {
+    return _now_us;
+}
+
+u32 backend_cycles(void) {
+    return 0;
+}
+
+void backend_set_polling(u8 ms) {
+    (void) ms;
+}
+
+void backend_send_report(u8 report_id, const void *report, u16 len) {
+    (void) report_id;
+    (void) report;
+    (void) len;
+}
+
+// Nothing is kept between runs
+bool storage_read(StorageSlot slot, void *data, u32 size) {
+    (void) slot;
+    (void) data;
+    (void) size;
+    return false;
+}
+
+bool storage_write(StorageSlot slot, const void *data, u32 size) {
+    (void) slot;
+    (void) data;
+    (void) size;
+    return true;
+}
+
+// Stands in for main.c's callback, without the hotkeys
+static void _frame_callback(void) {
+    _profile->task(_profile);
+    if (platform_get_mode() != _profile->mode) platform_set_mode(_profile->mode);
+
+    if (_profile->send) _profile->send(_profile);
+    else send_inputs(_profile->socd, _profile->keymap);
+}
+
+// What the backend does with a new sample, the edge times included
+static void _scan(InputMask inputs) {
+    static u32 edge_us[INPUT_COUNT];
+    static InputMask last = 0;
+
+    for (InputMask changed = inputs ^ last; changed; changed &= changed - 1) edge_us[__builtin_ctzll(changed)] = _now_us;
+    last = inputs;
+
+    device_scan(inputs, false, _now_us, edge_us);
+    device_frame(_frame_callback);
+}
+
+static u32 _random(u32 *state) {
+    u32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+// The same sequence every time, starting with everything let go: a press or release every fourth scan on average
+static void _play(u32 frames, bool measure) {
+    u32 seed = 0x2545F491;
+    InputMask inputs = 0;
+
+    for (u32 i = 0; i < frames; ++i) {
+        u32 r = _random(&seed);
+        if ((r & 3) == 0) inputs ^= INPUT_BIT((r >> 8) % _INPUT_PINS);
+        _now_us += _SCAN_US;
+
+        if (measure) _HOST_CALL(HOST_CALL_FRAME_BEGIN, 0);
+        _scan(inputs);
+        if (measure) _HOST_CALL(HOST_CALL_FRAME_END, 0);
+    }
+}
+
+static void _run_case(int id, const char *profile, InputMode mode, SocdType socd) {
+    select_profile(id);
+    _profile = get_active_profile();
+    _profile->mode = mode;
+    _profile->socd = socd;
+    platform_set_input_filter(_profile->filter);
+    platform_set_mode(mode);
+
+    _play(_WARMUP_FRAMES, false);
+
+    char name[64];
+    strcpy(name, profile);
+    strcat(name, "/");
+    strcat(name, _mode_names[mode]);
+    strcat(name, "/");
+    strcat(name, _socd_names[socd]);
+    _HOST_CALL(HOST_CALL_CASE, name);
+
+    _play(_FRAMES, true);
+}
+
+// A loop with a known cost, 1 + 5 + 4 * 2 + 1 cycles, so a run of this image also checks the simulator
+static void _run_calibration(void) {
+    _HOST_CALL(HOST_CALL_CASE, "calibration/loop");
+    _HOST_CALL(HOST_CALL_EXPECT, 15);
+
+    for (u32 i = 0; i < _FRAMES; ++i) {
+        __asm volatile (
+            "bkpt %[begin]\n"
+            "movs r1, #5\n"
+            "1: subs r1, #1\n"
+            "bne 1b\n"
+            "bkpt %[end]\n"
+            : : [begin] "i" (HOST_CALL_FRAME_BEGIN), [end] "i" (HOST_CALL_FRAME_END) : "r1", "cc");
+    }
+}
+
+int main(void) {
+    _run_calibration();
+
+    int id_default = register_profile(create_default_profile());
+    int id_ggst = register_profile(create_ggst_profile());
+    if (id_default == INVALID_ID || id_ggst == INVALID_ID) return 1;
+
+    for (InputMode mode = MODE_KEYBOARD; mode <= MODE_GAMEPAD; ++mode) {
+        for (SocdType socd = SOCD_NATURAL; socd <= SOCD_LAST_INPUT; ++socd) {
+            _run_case(id_default, "default", mode, socd);
+            _run_case(id_ggst, "ggst", mode, socd);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,314 @@
+// Monte Carlo model of the latency from a switch closing to the host reading the report that carries it.
+//
+// usage: latency_sim [-n trials] [-c calibration] [-p polling_ms,...] [-s scan_us] [-d debounce_us,...]
+//                    [-m margin_us,...] [-w wake_us] [-S seed]
+//
+// Every trial presses a button at a random time against a host whose frame clock has a random phase to the box's
+// timer, and follows it through the firmware's timing:
+//   - the scan task is released every scan_us (the polling interval by default, as in the firmware) and starts late
+//     by anything up to the scheduler's worst measured lateness, evenly spread, which is pessimistic. With power
+//     saving the loop sleeps until margin_us before the release and wakes up to wake_us late, so a wake-up error
+//     over the margin delays the scan too.
+//   - the press is sampled by the first scan that starts after it, or after the debounce window for a debounce
+//     that waits for the contact to settle (the Debounce stage reports presses at once, use 0 for it)
+//   - reading the inputs and latching them take read_us, then the frame is only built if the endpoint is free,
+//     which it is once the host has taken the previous report. Every frame with a free endpoint queues a report,
+//     the one with the press costs frame_us and the repeats before it skip_us.
+//   - the host reads the endpoint once every polling_ms frames of 1ms, complete_us before the endpoint is free again
+// Each configuration, every combination of the comma separated lists, prints the mean, median, 99th percentile and
+// worst latency and the share of scans that found the endpoint still busy.
+//
+// The per-stage costs come from the calibration, either a hidraw node of a running box, whose frame, scheduler and
+// input source statistics are read over the vendor report, or a text file. The text file takes the statistics the
+// Linux port prints with CHEATBOX_TRACE as they are, and "<name> <value>" lines for read_us, frame_us, skip_us,
+// late_us, wake_us and complete_us. Anything not calibrated is 0.
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/hidraw.h>
+
+#include "src/common.h"
+#include "src/settings.h"
+#include "src/vendor.h"
+#include "src/platform/input_source.h"
+#include "src/platform/report_ids.h"
+#include "src/platform/scheduler.h"
+
+#define _MAX_VALUES 8
+// Scans simulated before the press so the endpoint is in its steady state
+#define _WARMUP_SCANS 16
+// A trial that hasn't delivered the press after this many scans is counted at that point, it only happens when the
+// costs don't fit in the scan interval
+#define _MAX_SCANS 100000
+
+typedef struct {
+    double read_us;
+    double frame_us;
+    double skip_us;
+    double late_us;
+    double wake_us;
+    double complete_us;
+} _Calibration;
+
+typedef struct {
+    u32 polling_ms;
+    u32 scan_us;
+    u32 debounce_us;
+    u32 margin_us;
+} _Config;
+
+typedef struct {
+    u32 count;
+    u32 values[_MAX_VALUES];
+} _List;
+
+static u64 _rng = 0x9E3779B97F4A7C15ull;
+
+// xorshift64*, uniform in [0, 1)
+static double _random(void) {
+    _rng ^= _rng >> 12;
+    _rng ^= _rng << 25;
+    _rng ^= _rng >> 27;
+    return (double) ((_rng * 0x2545F4914F6CDD1Dull) >> 11) / (double) (1ull << 53);
+}
+
+static bool _parse_list(const char *text, _List *list) {
+    list->count = 0;
+    for (const char *cursor = text; *cursor; ) {
+        char *end;
+        unsigned long value = strtoul(cursor, &end, 10);
+        if (end == cursor || list->count == _MAX_VALUES) return false;
+
+        list->values[list->count++] = (u32) value;
+        cursor = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return false;
+    }
+    return list->count > 0;
+}
+
+static bool _feature(int fd, u8 command, u8 *response, int len) {
+    u8 report[1 + VENDOR_REPORT_SIZE] = { REPORT_ID_VENDOR, command };
+    if (ioctl(fd, HIDIOCSFEATURE(sizeof(report)), report) < 0) return false;
+
+    memset(report + 1, 0, VENDOR_REPORT_SIZE);
+    int read = ioctl(fd, HIDIOCGFEATURE(sizeof(report)), report);
+    if (read < 3 + len || report[1] != command) return false;
+
+    // Report id, command and argument come first
+    memcpy(response, report + 3, len);
+    return true;
+}
+
+static bool _calibrate_device(const char *path, _Calibration *calibration) {
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+
+    FrameStats frames;
+    u8 scheduler[1 + sizeof(SchedulerTaskStats)];
+    u8 sources[1 + INPUT_SOURCE_MAX * sizeof(InputSourceStats)];
+    bool ok = _feature(fd, VENDOR_CMD_FRAME_STATS, (u8 *) &frames, sizeof(frames)) &&
+              _feature(fd, VENDOR_CMD_SCHEDULER_STATS, scheduler, sizeof(scheduler)) &&
+              _feature(fd, VENDOR_CMD_INPUT_SOURCES, sources, 1);
+    if (ok) ok = _feature(fd, VENDOR_CMD_INPUT_SOURCES, sources, 1 + sources[0] * sizeof(InputSourceStats));
+    close(fd);
+
+    if (!ok) {
+        fprintf(stderr, "%s: can't read the statistics\n", path);
+        return false;
+    }
+
+    if (frames.evaluated) calibration->frame_us = (double) frames.eval_us / frames.evaluated;
+
+    // The scan is the first task
+    SchedulerTaskStats scan;
+    memcpy(&scan, scheduler + 1, sizeof(scan));
+    calibration->late_us = scan.max_late_us;
+
+    calibration->read_us = 0;
+    for (u8 i = 0; i < sources[0]; ++i) {
+        InputSourceStats source;
+        memcpy(&source, sources + 1 + i * sizeof(source), sizeof(source));
+        calibration->read_us += source.max_read_us;
+    }
+
+    return true;
+}
+
+static bool _calibrate_file(const char *path, _Calibration *calibration) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+
+    char line[256];
+    bool sources = false;
+    while (fgets(line, sizeof(line), file)) {
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        unsigned a, b, c, d;
+        char name[32];
+        double value;
+
+        if (sscanf(line, "frames %u evaluated %u skipped %u eval_us %u", &a, &b, &c, &d) == 4) {
+            if (b) calibration->frame_us = (double) d / b;
+        }
+        else if (sscanf(line, "task %u runs %u misses %u max_late_us %u", &a, &b, &c, &d) == 4) {
+            if (a == 0) calibration->late_us = d;
+        }
+        else if (sscanf(line, "source %u age_us %u max_age_us %u max_read_us %u", &a, &b, &c, &d) == 4) {
+            // The sum over the sources, which replaces any read_us line
+            if (!sources) calibration->read_us = 0;
+            sources = true;
+            calibration->read_us += d;
+        }
+        else if (sscanf(line, "%31s %lf", name, &value) == 2) {
+            if (strcmp(name, "read_us") == 0)          calibration->read_us = value;
+            else if (strcmp(name, "frame_us") == 0)    calibration->frame_us = value;
+            else if (strcmp(name, "skip_us") == 0)     calibration->skip_us = value;
+            else if (strcmp(name, "late_us") == 0)     calibration->late_us = value;
+            else if (strcmp(name, "wake_us") == 0)     calibration->wake_us = value;
+            else if (strcmp(name, "complete_us") == 0) calibration->complete_us = value;
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+// First host read of the endpoint at or after t
+static double _next_poll(double t, double phase_us, double interval_us) {
+    double k = ceil((t - phase_us) / interval_us);
+    return phase_us + k * interval_us;
+}
+
+// Latency of one press, counts the scans that found the endpoint busy
+static double _trial(const _Config *config, const _Calibration *calibration, u32 *scans, u32 *busy) {
+    double scan_us = config->scan_us ? config->scan_us : config->polling_ms * 1000.0;
+    double poll_us = config->polling_ms * 1000.0;
+    double phase_us = _random() * poll_us;
+    double press_us = (_WARMUP_SCANS + _random()) * scan_us;
+    double visible_us = press_us + config->debounce_us;
+
+    // Time the host takes the report queued last, the endpoint is free again complete_us after it
+    double taken_us = -1e18;
+    double idle_us = scan_us - calibration->read_us - calibration->frame_us;
+
+    for (u32 k = 0; k < _MAX_SCANS; ++k) {
+        double late = _random() * calibration->late_us;
+        if (idle_us > config->margin_us) {
+            double overshoot = _random() * calibration->wake_us;
+            if (overshoot > config->margin_us) late += overshoot - config->margin_us;
+        }
+
+        double start_us = k * scan_us + late;
+        double ready_us = start_us + calibration->read_us;
+        *scans += 1;
+
+        if (taken_us + calibration->complete_us > ready_us) {
+            *busy += 1;
+            continue;
+        }
+
+        bool carries = start_us >= visible_us;
+        double queued_us = ready_us + (carries ? calibration->frame_us : calibration->skip_us);
+        taken_us = _next_poll(queued_us, phase_us, poll_us);
+
+        if (carries) return taken_us - press_us;
+    }
+
+    return _MAX_SCANS * scan_us - press_us;
+}
+
+static int _compare(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static void _run(const _Config *config, const _Calibration *calibration, u32 trials, double *latencies) {
+    u32 scans = 0, busy = 0;
+    double sum = 0;
+
+    for (u32 i = 0; i < trials; ++i) {
+        latencies[i] = _trial(config, calibration, &scans, &busy);
+        sum += latencies[i];
+    }
+
+    qsort(latencies, trials, sizeof(*latencies), _compare);
+
+    printf("%7u %7u %8u %6u  %8.1f %8.1f %8.1f %8.1f  %5.1f%%\n", config->polling_ms,
+           config->scan_us ? config->scan_us : config->polling_ms * 1000, config->debounce_us, config->margin_us,
+           sum / trials, latencies[trials / 2], latencies[(u32) (trials * 0.99)], latencies[trials - 1],
+           100.0 * busy / scans);
+}
+
+int main(int argc, char **argv) {
+    u32 trials = 100000;
+    u32 scan_us = 0;
+    const char *calibration_path = NULL;
+    _List polling = { 1, { POLLING_RATE } };
+    _List debounce = { 1, { 0 } };
+    _List margin = { 1, { 50 } };
+    _Calibration calibration = {0};
+    double wake_us = -1;
+
+    int arg = 1;
+    bool ok = true;
+    for (; ok && arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        const char *value = argv[arg + 1];
+
+        if (strcmp(argv[arg], "-n") == 0)      trials = (u32) atol(value);
+        else if (strcmp(argv[arg], "-c") == 0) calibration_path = value;
+        else if (strcmp(argv[arg], "-p") == 0) ok = _parse_list(value, &polling);
+        else if (strcmp(argv[arg], "-s") == 0) scan_us = (u32) atol(value);
+        else if (strcmp(argv[arg], "-d") == 0) ok = _parse_list(value, &debounce);
+        else if (strcmp(argv[arg], "-m") == 0) ok = _parse_list(value, &margin);
+        else if (strcmp(argv[arg], "-w") == 0) wake_us = atof(value);
+        else if (strcmp(argv[arg], "-S") == 0) _rng = strtoull(value, NULL, 0) | 1;
+        else ok = false;
+    }
+
+    for (u32 i = 0; i < polling.count; ++i) ok = ok && polling.values[i] > 0;
+
+    if (!ok || arg != argc || trials == 0) {
+        fprintf(stderr, "usage: %s [-n trials] [-c calibration] [-p polling_ms,...] [-s scan_us] [-d debounce_us,...] "
+                        "[-m margin_us,...] [-w wake_us] [-S seed]\n", argv[0]);
+        return 1;
+    }
+
+    if (calibration_path) {
+        struct stat info;
+        bool device = stat(calibration_path, &info) == 0 && S_ISCHR(info.st_mode);
+        bool loaded = device ? _calibrate_device(calibration_path, &calibration)
+                             : _calibrate_file(calibration_path, &calibration);
+        if (!loaded) return 1;
+    }
+    if (wake_us >= 0) calibration.wake_us = wake_us;
+
+    printf("read %.1f us, frame %.1f us, repeat %.1f us, late up to %.1f us, wake up to %.1f us, complete %.1f us\n",
+           calibration.read_us, calibration.frame_us, calibration.skip_us, calibration.late_us, calibration.wake_us,
+           calibration.complete_us);
+    printf("polling scan_us debounce margin      mean      p50      p99      max   busy\n");
+
+    double *latencies = malloc(trials * sizeof(*latencies));
+    for (u32 p = 0; p < polling.count; ++p) {
+        for (u32 d = 0; d < debounce.count; ++d) {
+            for (u32 m = 0; m < margin.count; ++m) {
+                _Config config = { polling.values[p], scan_us, debounce.values[d], margin.values[m] };
+                _run(&config, &calibration, trials, latencies);
+            }
+        }
+    }
+
+    free(latencies);
+    return 0;
+}
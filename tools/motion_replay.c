@@ -0,0 +1,101 @@
+// Runs a trace of resolved directions through the motion recognizer with the settings from settings.h.
+//
+// usage: motion_replay [-w window] <trace> <pattern>...
+//
+// Patterns are numpad directions, e.g. 236 or 41236. A charge time in report ticks goes in front: [750]46.
+// -w sets the window of every pattern, MOTION_WINDOW_TICKS by default.
+//
+// The trace has one "<tick> <direction> [patterns]" line per frame the direction changes, lines starting with #
+// are comments. When any line lists patterns, the patterns matched on every line have to be exactly the listed
+// ones (comma separated, as written on the command line) and the exit code says whether they were.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/common.h"
+#include "src/motion.h"
+
+int main(int argc, char **argv) {
+    int arg = 1;
+    u16 window = 0;
+    if (arg + 1 < argc && strcmp(argv[arg], "-w") == 0) {
+        window = (u16) atoi(argv[arg + 1]);
+        arg += 2;
+    }
+
+    int count = argc - arg - 1;
+    if (count < 1 || count > MOTION_MAX_PATTERNS) {
+        fprintf(stderr, "usage: %s [-w window] <trace> <pattern>... (at most %d patterns)\n", argv[0], MOTION_MAX_PATTERNS);
+        return 1;
+    }
+
+    const char *trace = argv[arg];
+    const char *names[MOTION_MAX_PATTERNS];
+    MotionPattern patterns[MOTION_MAX_PATTERNS];
+
+    for (int i = 0; i < count; ++i) {
+        const char *text = argv[arg + 1 + i];
+        names[i] = text;
+        patterns[i] = (MotionPattern) { text, window, 0 };
+
+        if (text[0] == '[') {
+            char *end;
+            patterns[i].charge = (u16) strtoul(text + 1, &end, 10);
+            patterns[i].directions = *end == ']' ? end + 1 : "";
+        }
+    }
+
+    MotionTable table;
+    if (!motion_build(&table, patterns, (u8) count)) {
+        fprintf(stderr, "invalid patterns or more than %d states\n", MOTION_MAX_STATES);
+        return 1;
+    }
+
+    FILE *file = fopen(trace, "r");
+    if (!file) {
+        perror(trace);
+        return 1;
+    }
+
+    MotionState state;
+    motion_reset(&state);
+
+    char line[256];
+    u32 steps = 0, matches = 0, mismatches = 0;
+    bool checked = false;
+
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+
+        unsigned tick, direction;
+        char expected[128] = "";
+        int fields = sscanf(line, "%u %u %127s", &tick, &direction, expected);
+        if (fields < 2) continue;
+        if (fields == 3) checked = true;
+
+        u8 matched = motion_step(&table, &state, (u8) direction, tick);
+        steps += 1;
+
+        // Listed the same way as the expectations so the two can be compared as text
+        char actual[128] = "";
+        for (int i = 0; i < count; ++i) {
+            if (!(matched & (1u << i))) continue;
+
+            if (actual[0]) strcat(actual, ",");
+            strncat(actual, names[i], sizeof(actual) - strlen(actual) - 2);
+            printf("%u %s\n", tick, names[i]);
+            matches += 1;
+        }
+
+        if (strcmp(actual, expected) != 0 && (checked || fields == 3)) {
+            fprintf(stderr, "tick %u: expected '%s', matched '%s'\n", tick, expected, actual);
+            mismatches += 1;
+        }
+    }
+
+    fclose(file);
+
+    printf("%u changes, %u matches, %d states\n", steps, matches, table.state_count);
+    if (checked) printf("%u mismatches\n", mismatches);
+    return mismatches ? 2 : 0;
+}
@@ -0,0 +1,260 @@
+// Runs the input pipeline of a profile (see src/pipeline.hpp), or one part of it, against an input script and
+// times it. The firmware core is linked in as is, only the backend is replaced by a simulated scan clock.
+//
+// usage: pipeline_bench [-p default|ggst] [-s physical|mapping|output|all] [-i interval_us] [-n passes] script.txt
+//
+// The script has the CHEATBOX_SCRIPT format, "<time_ms> <pin> <0|1>" per line. The inputs are scanned every
+// interval_us (POLLING_RATE by default) and every change of the selected part's output is printed:
+//   physical: the inputs after the physical filters, as a hex mask
+//   mapping:  the virtual buttons the mapping pressed, before the virtual filters
+//   output:   the report, as "<us> <id> <hex bytes>" without the REPORT_TIMING field
+//   all:      the same, but the time covers the whole chain from the scan to the report
+// With -n the script is played that many times back to back for the timing, only the first pass is printed.
+// The time per scan goes to stderr.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "src/common.h"
+#include "src/settings.h"
+#include "src/profile.h"
+#include "src/profiles/default.h"
+#include "src/profiles/ggst.h"
+#include "src/platform/device.h"
+#include "src/platform/report_ids.h"
+#include "src/platform/storage.h"
+
+// Scans played after the last event so releases and timers settle
+#define _TAIL_SCANS 100
+
+typedef enum {
+    _PART_PHYSICAL,
+    _PART_MAPPING,
+    _PART_OUTPUT,
+    _PART_ALL,
+} _Part;
+
+typedef struct {
+    u32 time_us;
+    u8 pin;
+    bool down;
+} _Event;
+
+static _Event *_events = NULL;
+static size_t _event_count = 0;
+
+static u32 _now_us = 0;
+static _Part _part = _PART_ALL;
+static bool _print = true;
+static Profile *_profile = NULL;
+
+// Last printed output of each kind
+static u64 _last_mask = 0;
+static u8 _last_report[3][64];
+static u16 _last_len[3];
+
+static u64 _ns_total = 0;
+static u64 _ns_max = 0;
+static u32 _measured = 0;
+
+static u64 _clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void _measure(u64 start_ns) {
+    u64 ns = _clock_ns() - start_ns;
+    _ns_total += ns;
+    if (ns > _ns_max) _ns_max = ns;
+    _measured += 1;
+}
+
+static void _print_mask(u64 mask) {
+    if (!_print || mask == _last_mask) return;
+    _last_mask = mask;
+    printf("%u %016llx\n", _now_us, (unsigned long long) mask);
+}
+
+// The simulated backend
+u32 backend_time_us(void) {
+    return _now_us;
+}
+
+u32 backend_cycles(void) {
+    return 0;
+}
+
+void backend_set_polling(u8 ms) {
+    (void) ms;
+}
+
+void backend_send_report(u8 report_id, const void *report, u16 len) {
+    // Only the input fields, the timing field differs in every report
+    u16 payload = report_id == REPORT_ID_KEYBOARD ? 13 : 11;
+    if (len > payload) len = payload;
+    if (!_print || _part < _PART_OUTPUT || report_id > 2) return;
+
+    if (len == _last_len[report_id] && memcmp(_last_report[report_id], report, len) == 0) return;
+    memcpy(_last_report[report_id], report, len);
+    _last_len[report_id] = len;
+
+    printf("%u %u", _now_us, report_id);
+    for (u16 i = 0; i < len; ++i) printf(" %02x", ((const u8 *) report)[i]);
+    printf("\n");
+}
+
+// Nothing is kept between runs
+bool storage_read(StorageSlot slot, void *data, u32 size) {
+    (void) slot;
+    (void) data;
+    (void) size;
+    return false;
+}
+
+bool storage_write(StorageSlot slot, const void *data, u32 size) {
+    (void) slot;
+    (void) data;
+    (void) size;
+    return true;
+}
+
+// Stands in for main.c's callback, without the hotkeys
+static void _frame_callback(void) {
+    u64 start = _clock_ns();
+
+    _profile->task(_profile);
+    if (platform_get_mode() != _profile->mode) platform_set_mode(_profile->mode);
+
+    if (_part == _PART_MAPPING) {
+        u64 buttons = latch_inputs();
+        _measure(start);
+        _print_mask(buttons);
+        return;
+    }
+
+    if (_part == _PART_OUTPUT) start = _clock_ns();
+    if (_profile->send) _profile->send(_profile);
+    else send_inputs(_profile->socd, _profile->keymap);
+
+    if (_part == _PART_OUTPUT) _measure(start);
+}
+
+static void _scan(InputMask inputs) {
+    static u32 edge_us[INPUT_COUNT];
+    static InputMask last = 0;
+
+    for (InputMask changed = inputs ^ last; changed; changed &= changed - 1) edge_us[__builtin_ctzll(changed)] = _now_us;
+    last = inputs;
+
+    if (_part == _PART_PHYSICAL) {
+        u64 start = _clock_ns();
+        InputMask filtered = _profile->filter ? _profile->filter(inputs, _now_us) : inputs;
+        _measure(start);
+        _print_mask(filtered);
+        return;
+    }
+
+    u64 start = _clock_ns();
+    device_scan(inputs, false, _now_us, edge_us);
+    device_frame(_frame_callback);
+    if (_part == _PART_ALL) _measure(start);
+}
+
+static bool _load_script(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+
+    size_t capacity = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        double time_ms;
+        int pin, down;
+        int fields = sscanf(line, "%lf %d %d", &time_ms, &pin, &down);
+        if (fields <= 0) continue;
+        if (fields != 3 || pin < 0 || pin >= INPUT_COUNT || time_ms < 0) continue;
+
+        if (_event_count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            _events = realloc(_events, capacity * sizeof(*_events));
+        }
+        _events[_event_count++] = (_Event) { (u32) (time_ms * 1000.0), (u8) pin, down != 0 };
+    }
+
+    fclose(file);
+    return _event_count > 0;
+}
+
+int main(int argc, char **argv) {
+    const char *profile = "default";
+    const char *part = "all";
+    u32 interval_us = POLLING_RATE * 1000;
+    u32 passes = 1;
+
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        if (strcmp(argv[arg], "-p") == 0)      profile = argv[arg + 1];
+        else if (strcmp(argv[arg], "-s") == 0) part = argv[arg + 1];
+        else if (strcmp(argv[arg], "-i") == 0) interval_us = (u32) atoi(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-n") == 0) passes = (u32) atoi(argv[arg + 1]);
+        else break;
+    }
+
+    if (strcmp(part, "physical") == 0)     _part = _PART_PHYSICAL;
+    else if (strcmp(part, "mapping") == 0) _part = _PART_MAPPING;
+    else if (strcmp(part, "output") == 0)  _part = _PART_OUTPUT;
+    else if (strcmp(part, "all") == 0)     _part = _PART_ALL;
+    else arg = argc;
+
+    Profile created;
+    if (strcmp(profile, "default") == 0)   created = create_default_profile();
+    else if (strcmp(profile, "ggst") == 0) created = create_ggst_profile();
+    else arg = argc;
+
+    if (arg != argc - 1 || interval_us == 0 || passes == 0) {
+        fprintf(stderr, "usage: %s [-p default|ggst] [-s physical|mapping|output|all] [-i interval_us] [-n passes] "
+                        "script.txt\n", argv[0]);
+        return 1;
+    }
+
+    if (!_load_script(argv[arg])) {
+        fprintf(stderr, "%s: no events\n", argv[arg]);
+        return 1;
+    }
+
+    select_profile(register_profile(created));
+    _profile = get_active_profile();
+    platform_set_input_filter(_profile->filter);
+    platform_set_mode(_profile->mode);
+
+    u32 length_us = _events[_event_count - 1].time_us + _TAIL_SCANS * interval_us;
+    for (u32 pass = 0; pass < passes; ++pass) {
+        u32 origin_us = _now_us;
+        size_t next = 0;
+        InputMask inputs = 0;
+
+        for (u32 t = 0; t < length_us; t += interval_us) {
+            _now_us = origin_us + t;
+            for (; next < _event_count && _events[next].time_us <= t; ++next) {
+                if (_events[next].down) inputs |= INPUT_BIT(_events[next].pin);
+                else inputs &= ~INPUT_BIT(_events[next].pin);
+            }
+
+            _scan(inputs);
+        }
+
+        _print = false;
+        _now_us = origin_us + length_us;
+    }
+
+    fprintf(stderr, "%s %s: %u measured, mean %.1f ns, max %llu ns\n", profile, part, _measured,
+            _measured ? (double) _ns_total / _measured : 0.0, (unsigned long long) _ns_max);
+    return 0;
+}
@@ -0,0 +1,147 @@
+@ plugins/example.c written out by hand, so cycle_bench can run a plugin under ctest on hosts without an arm
+@ toolchain. It has to behave exactly like the C version: with the toolchain the linux build also runs the compiled
+@ example_plugin.bin against the same plink.expected. Linked with plugins/plugin.ld like any other plugin.
+@
+@ example.bin is checked in. To rebuild it:
+@     arm-none-eabi-as -mcpu=cortex-m0plus example.s -o example.o
+@     arm-none-eabi-ld -T ../../plugins/plugin.ld example.o -o example.elf
+@     arm-none-eabi-objcopy -O binary example.elf example.bin
+
+    .syntax unified
+    .cpu cortex-m0plus
+    .thumb
+
+@ plugin_abi.h
+    .equ PLUGIN_MAGIC, 0x4F504C47
+    .equ PLUGIN_ABI_VERSION, 1
+    .equ PLUGIN_ARCH_ARMV6M, 1
+    .equ PLUGIN_PROFILE_STATE_OFFSET, 36
+    .equ CONTEXT_API, 0
+    .equ CONTEXT_STATE, 8
+    .equ API_BUTTON_DOWN, 8
+    .equ API_BUTTON_PRESSED, 16
+    .equ API_REPORT_TICK, 36
+    .equ API_REQUEST_UPDATE, 40
+    .equ API_BIND, 56
+
+@ cheatbox.h, virtual_button.h and platform.h
+    .equ BUTTON_RING, 1
+    .equ BUTTON_MIDDLE, 2
+    .equ BUTTON_INDEX, 3
+    .equ BUTTON_TOP_1, 4
+    .equ BUTTON_LEFT_THUMB_1, 12
+    .equ BUTTON_LEFT_THUMB_2, 13
+    .equ UP, 0
+    .equ DOWN, 1
+    .equ LEFT, 2
+    .equ RIGHT, 3
+    .equ ATTACK_1, 4
+    .equ SOCD_NEUTRAL, 2
+    .equ MODE_GAMEPAD, 1
+
+@ example.c
+    .equ FIRST_ATTACK, BUTTON_TOP_1
+    .equ PLINK_PIN, BUTTON_LEFT_THUMB_2
+    .equ PLINK_GAP, 2
+    .equ STATE_PLINKING, 32
+    .equ STATE_SIZE, 36
+
+    .macro bind index, button
+    movs r0, #\index
+    movs r1, #\button
+    ldr r3, [r4, #API_BIND]
+    blx r3
+    .endm
+
+    .section .plugin_header, "a"
+    .word PLUGIN_MAGIC
+    .short PLUGIN_ABI_VERSION
+    .short 44
+    .word 0                 @ size and checksum, filled in by plugin_upload
+    .word 0
+    .word task
+    .short STATE_SIZE
+    .byte SOCD_NEUTRAL
+    .byte MODE_GAMEPAD
+    .byte PLUGIN_ARCH_ARMV6M
+    .byte 0, 0, 0
+    .ascii "plink"
+    .space 11
+
+    .text
+@ r4 api, r5 state, r6 tick, r7 attack
+    .thumb_func
+task:
+    push {r4, r5, r6, r7, lr}
+    ldr r1, [r0, #PLUGIN_PROFILE_STATE_OFFSET]
+    ldr r4, [r1, #CONTEXT_API]
+    movs r5, r1
+    adds r5, #CONTEXT_STATE
+    ldr r3, [r4, #API_REPORT_TICK]
+    blx r3
+    movs r6, r0
+
+    bind BUTTON_RING, LEFT
+    bind BUTTON_MIDDLE, DOWN
+    bind BUTTON_INDEX, RIGHT
+    bind BUTTON_LEFT_THUMB_1, UP
+
+    movs r7, #0
+attack:
+    @ A press with the plink pin held starts a plink
+    adds r0, r7, #FIRST_ATTACK
+    ldr r3, [r4, #API_BUTTON_PRESSED]
+    blx r3
+    cmp r0, #0
+    beq plinking
+    movs r0, #PLINK_PIN
+    ldr r3, [r4, #API_BUTTON_DOWN]
+    blx r3
+    cmp r0, #0
+    beq plinking
+    lsls r0, r7, #2
+    str r6, [r5, r0]
+    movs r1, #1
+    lsls r1, r7
+    movs r2, #STATE_PLINKING
+    ldrb r0, [r5, r2]
+    orrs r0, r1
+    strb r0, [r5, r2]
+
+plinking:
+    movs r2, #STATE_PLINKING
+    ldrb r0, [r5, r2]
+    movs r1, #1
+    lsls r1, r7
+    tst r0, r1
+    beq press
+    lsls r2, r7, #2
+    ldr r2, [r5, r2]
+    subs r2, r6, r2
+    cmp r2, #PLINK_GAP
+    bls gap
+    bics r0, r1
+    movs r2, #STATE_PLINKING
+    strb r0, [r5, r2]
+    b press
+
+gap:
+    @ Released for the ticks after the first press, with the age read again after the call
+    ldr r3, [r4, #API_REQUEST_UPDATE]
+    blx r3
+    lsls r2, r7, #2
+    ldr r2, [r5, r2]
+    cmp r2, r6
+    bne next
+
+press:
+    adds r0, r7, #FIRST_ATTACK
+    adds r1, r7, #ATTACK_1
+    ldr r3, [r4, #API_BIND]
+    blx r3
+
+next:
+    adds r7, #1
+    cmp r7, #8
+    blt attack
+    pop {r4, r5, r6, r7, pc}
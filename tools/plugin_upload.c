@@ -0,0 +1,155 @@
+// Uploads a plugin image over the vendor feature report and prints the status the firmware reports back.
+//
+// usage: plugin_upload /dev/hidrawN [image.bin]
+//
+// The image is the raw output of the plugin build (see plugins/). The size and checksum fields of its header are
+// filled in here before it is sent. Without an image only the status is printed.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/hidraw.h>
+
+#include "src/common.h"
+#include "src/settings.h"
+#include "src/plugin.h"
+#include "src/plugin_abi.h"
+#include "src/vendor.h"
+#include "src/platform/report_ids.h"
+
+// Offset, count and data after the command
+#define _CHUNK_SIZE (VENDOR_REPORT_SIZE - 4)
+
+static const char *_states[] = {
+    [PLUGIN_EMPTY] = "empty",
+    [PLUGIN_UPLOADING] = "uploading",
+    [PLUGIN_READY] = "ready",
+    [PLUGIN_INVALID] = "invalid",
+    [PLUGIN_UNSUPPORTED] = "unsupported",
+    [PLUGIN_OVERRUN] = "disabled, over the cycle budget",
+    [PLUGIN_HUNG] = "disabled, hung the previous boot",
+};
+
+static bool _send(int fd, const u8 *payload, u16 len) {
+    u8 report[1 + VENDOR_REPORT_SIZE] = { REPORT_ID_VENDOR };
+    memcpy(report + 1, payload, len);
+
+    if (ioctl(fd, HIDIOCSFEATURE(sizeof(report)), report) < 0) {
+        perror("HIDIOCSFEATURE");
+        return false;
+    }
+    return true;
+}
+
+static bool _read_status(int fd, PluginStatus *status) {
+    u8 command = VENDOR_CMD_PLUGIN_STATUS;
+    if (!_send(fd, &command, 1)) return false;
+
+    u8 report[1 + VENDOR_REPORT_SIZE] = { REPORT_ID_VENDOR };
+    int read = ioctl(fd, HIDIOCGFEATURE(sizeof(report)), report);
+    if (read < 0) {
+        perror("HIDIOCGFEATURE");
+        return false;
+    }
+
+    // Report id, command and argument come first
+    if (read < (int) (3 + sizeof(*status)) || report[1] != VENDOR_CMD_PLUGIN_STATUS) {
+        fprintf(stderr, "unexpected status response\n");
+        return false;
+    }
+
+    memcpy(status, report + 3, sizeof(*status));
+    return true;
+}
+
+static void _print_status(const PluginStatus *status) {
+    const char *state = status->state < array_len(_states) ? _states[status->state] : "?";
+
+    printf("state:    %s\n", state);
+    if (status->state == PLUGIN_EMPTY) return;
+
+    printf("name:     %.16s\n", status->name);
+    printf("size:     %u bytes, checksum %08x\n", status->size, status->checksum);
+    printf("runs:     %u\n", status->runs);
+    printf("cycles:   last %u, max %u, budget %u\n", status->last_cycles, status->max_cycles, PLUGIN_BUDGET_CYCLES);
+    printf("overruns: %u\n", status->overruns);
+}
+
+static u8 *_load_image(const char *path, u32 *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return NULL;
+    }
+
+    u8 *image = calloc(1, PLUGIN_MAX_SIZE + 1);
+    *size = (u32) fread(image, 1, PLUGIN_MAX_SIZE + 1, file);
+    fclose(file);
+
+    PluginHeader header;
+    if (*size < sizeof(header) || *size > PLUGIN_MAX_SIZE) {
+        fprintf(stderr, "%s: %u bytes, images are %zu to %d bytes\n", path, *size, sizeof(header), PLUGIN_MAX_SIZE);
+        free(image);
+        return NULL;
+    }
+
+    memcpy(&header, image, sizeof(header));
+    if (header.magic != PLUGIN_MAGIC || header.header_size != sizeof(header)) {
+        fprintf(stderr, "%s: no plugin header at the start, was it linked with plugins/plugin.ld?\n", path);
+        free(image);
+        return NULL;
+    }
+
+    header.size = *size;
+    memcpy(image, &header, sizeof(header));
+
+    header.checksum = plugin_checksum(image, *size);
+    memcpy(image, &header, sizeof(header));
+    return image;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s /dev/hidrawN [image.bin]\n", argv[0]);
+        return 1;
+    }
+
+    int fd = open(argv[1], O_RDWR);
+    if (fd < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    if (argc == 3) {
+        u32 size;
+        u8 *image = _load_image(argv[2], &size);
+        if (!image) return 1;
+
+        u8 begin[6] = { VENDOR_CMD_PLUGIN_BEGIN, 0, size, size >> 8, size >> 16, size >> 24 };
+        bool sent = _send(fd, begin, sizeof(begin));
+
+        for (u32 offset = 0; sent && offset < size; offset += _CHUNK_SIZE) {
+            u8 count = (u8) (size - offset < _CHUNK_SIZE ? size - offset : _CHUNK_SIZE);
+            u8 chunk[VENDOR_REPORT_SIZE] = { VENDOR_CMD_PLUGIN_DATA, count, offset, offset >> 8 };
+            memcpy(chunk + 4, image + offset, count);
+            sent = _send(fd, chunk, 4 + count);
+        }
+
+        // Storing it stalls the device for a moment, the status read waits for that
+        u8 commit = VENDOR_CMD_PLUGIN_COMMIT;
+        if (sent) sent = _send(fd, &commit, 1);
+
+        free(image);
+        if (!sent) return 1;
+        printf("uploaded %u bytes\n", size);
+    }
+
+    PluginStatus status;
+    if (!_read_status(fd, &status)) return 1;
+    _print_status(&status);
+
+    close(fd);
+    return status.state == PLUGIN_READY || (argc == 2 && status.state == PLUGIN_EMPTY) ? 0 : 2;
+}
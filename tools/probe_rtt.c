@@ -0,0 +1,195 @@
+// Measures the full host -> device -> host round trip through the keyboard output report probe.
+//
+// usage: probe_rtt /dev/hidrawN [probe count]
+//
+// Every probe writes a keyboard output report with a token and waits for the input report that echoes it.
+// Round trip: host write to host read of the echo, both usb directions plus the wait for the next frame.
+// Device:     output report arriving to the echo being queued, measured by the firmware.
+// Phase:      how far into the scan the output report arrived. Probes are spaced randomly so this should be flat,
+//             peaks mean the host lines its transfers up with the device frames.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "src/common.h"
+#include "src/settings.h"
+#include "src/platform/report_ids.h"
+
+// Offset of the timing field after the report id
+#define _KEYBOARD_TIMING_OFFSET 13
+#define _GAMEPAD_TIMING_OFFSET  11
+
+// Probe fields inside the timing field
+#define _PROBE_PHASE_OFFSET     6
+#define _PROBE_TO_REPORT_OFFSET 8
+#define _PROBE_ECHO_OFFSET      10
+
+#define _TIMEOUT_MS 100
+#define _PHASE_BINS 10
+
+typedef struct {
+    double *values;
+    size_t count;
+} _Samples;
+
+static volatile sig_atomic_t _stop = 0;
+
+// Set when an input report is too short to carry the timing field
+static bool _untimed = false;
+
+static void _on_signal(int signal) {
+    (void) signal;
+    _stop = 1;
+}
+
+static u64 _clock_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static u16 _read_u16(const u8 *data) {
+    return data[0] | (data[1] << 8);
+}
+
+static void _push(_Samples *samples, double value) {
+    samples->values[samples->count++] = value;
+}
+
+static int _compare(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static void _print(const char *name, _Samples *samples) {
+    if (samples->count == 0) {
+        printf("%-22s no samples\n", name);
+        return;
+    }
+
+    qsort(samples->values, samples->count, sizeof(double), _compare);
+
+    double sum = 0;
+    for (size_t i = 0; i < samples->count; ++i) sum += samples->values[i];
+
+    double *v = samples->values;
+    size_t n = samples->count;
+    printf("%-22s n=%-8zu min=%8.1f mean=%8.1f p50=%8.1f p99=%8.1f max=%8.1f us\n", name, n,
+           v[0], sum / n, v[n / 2], v[(n * 99) / 100], v[n - 1]);
+}
+
+// Waits for the input report that echoes token, returns its length or -1 on a timeout or error
+static ssize_t _wait_echo(int fd, u8 token, u8 *buffer, size_t size, u64 *rx) {
+    u64 deadline = _clock_us() + _TIMEOUT_MS * 1000;
+
+    while (!_stop) {
+        u64 now = _clock_us();
+        if (now >= deadline) return -1;
+
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, (int) ((deadline - now + 999) / 1000));
+        if (ready < 0 && errno != EINTR) return -1;
+        if (ready <= 0) continue;
+
+        ssize_t len = read(fd, buffer, size);
+        *rx = _clock_us();
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+
+        int offset;
+        switch (buffer[0]) {
+            case REPORT_ID_KEYBOARD: offset = 1 + _KEYBOARD_TIMING_OFFSET; break;
+            case REPORT_ID_GAMEPAD:  offset = 1 + _GAMEPAD_TIMING_OFFSET;  break;
+            default: continue;
+        }
+        if (len <= offset + _PROBE_ECHO_OFFSET) {
+            _untimed = true;
+            continue;
+        }
+
+        if (buffer[offset + _PROBE_ECHO_OFFSET] == token) return offset;
+    }
+
+    return -1;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s /dev/hidrawN [probe count]\n", argv[0]);
+        return 1;
+    }
+
+    int fd = open(argv[1], O_RDWR);
+    if (fd < 0) {
+        fprintf(stderr, "can't open %s: %s\n", argv[1], strerror(errno));
+        return 1;
+    }
+
+    long limit = argc > 2 ? atol(argv[2]) : 1000;
+    if (limit <= 0) limit = 1000;
+    signal(SIGINT, _on_signal);
+    srand((unsigned) _clock_us());
+
+    _Samples round_trip = { calloc(limit, sizeof(double)), 0 };
+    _Samples device = { calloc(limit, sizeof(double)), 0 };
+    u32 phase[_PHASE_BINS] = {0};
+    double period_us = POLLING_RATE * 1000.0;
+
+    long sent = 0, lost = 0;
+    u8 token = 0;
+    u8 buffer[64];
+
+    while (!_stop && sent < limit) {
+        // 0 means no probe to the firmware
+        token = token == 255 ? 1 : token + 1;
+
+        u8 report[3] = { REPORT_ID_KEYBOARD, 0, token };
+        u64 tx = _clock_us();
+        if (write(fd, report, sizeof(report)) != (ssize_t) sizeof(report)) {
+            fprintf(stderr, "write failed: %s\n", strerror(errno));
+            break;
+        }
+        sent += 1;
+
+        u64 rx = 0;
+        ssize_t offset = _wait_echo(fd, token, buffer, sizeof(buffer), &rx);
+        if (offset < 0) {
+            lost += 1;
+            continue;
+        }
+
+        _push(&round_trip, (double) (rx - tx));
+
+        u16 to_report = _read_u16(buffer + offset + _PROBE_TO_REPORT_OFFSET);
+        u16 phase_us = _read_u16(buffer + offset + _PROBE_PHASE_OFFSET);
+        if (to_report != REPORT_TIMING_NO_EDGE) _push(&device, to_report);
+        if (phase_us != REPORT_TIMING_NO_EDGE) {
+            int bin = (int) (phase_us * _PHASE_BINS / period_us);
+            phase[bin < _PHASE_BINS ? bin : _PHASE_BINS - 1] += 1;
+        }
+
+        // Random spacing so the probes land all over the device frame
+        usleep((useconds_t) (rand() % (int) (2 * period_us)));
+    }
+
+    if (lost == sent && _untimed) fprintf(stderr, "firmware was built without REPORT_TIMING\n");
+    printf("probes: %ld, unanswered: %ld\n", sent, lost);
+    _print("round trip", &round_trip);
+    _print("device out->report", &device);
+
+    printf("output report phase in the scan:\n");
+    for (int i = 0; i < _PHASE_BINS; ++i) {
+        printf("  %6.0f-%6.0f us %8u\n", i * period_us / _PHASE_BINS, (i + 1) * period_us / _PHASE_BINS, phase[i]);
+    }
+
+    close(fd);
+    return 0;
+}
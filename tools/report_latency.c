@@ -0,0 +1,200 @@
+// Reads the cheatbox reports from a hidraw node and uses the REPORT_TIMING field to measure latency.
+//
+// usage: report_latency [-i interval_us] /dev/hidrawN [report count]
+//
+// Device side: time from the newest physical edge to the report being queued, measured by the firmware.
+// Transport:   host receive time minus the scan time of the report. The two clocks are not synchronised so this is
+//              shown relative to the fastest report seen, which leaves the jitter added by usb and the host.
+// Drops:       gaps in the report sequence number.
+//
+// The box scans once per report interval. That interval is the bInterval the host polls the endpoint at, which the
+// active profile can change, so it is read from sysfs unless -i gives it.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "src/common.h"
+#include "src/settings.h"
+#include "src/platform/report_ids.h"
+
+#define _MAX_SAMPLES (1 << 20)
+
+// Offset of the timing field after the report id
+#define _KEYBOARD_TIMING_OFFSET 13
+#define _GAMEPAD_TIMING_OFFSET  11
+
+// The input endpoint, USB_HID_IN_ENDPOINT
+#define _ENDPOINT "ep_81"
+
+typedef struct {
+    double *values;
+    size_t count;
+} _Samples;
+
+static volatile sig_atomic_t _stop = 0;
+
+static void _on_signal(int signal) {
+    (void) signal;
+    _stop = 1;
+}
+
+static u64 _clock_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static u16 _read_u16(const u8 *data) {
+    return data[0] | (data[1] << 8);
+}
+
+static void _push(_Samples *samples, double value) {
+    if (samples->count < _MAX_SAMPLES) samples->values[samples->count++] = value;
+}
+
+static int _compare(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static void _print(const char *name, _Samples *samples, double offset) {
+    if (samples->count == 0) {
+        printf("%-22s no samples\n", name);
+        return;
+    }
+
+    qsort(samples->values, samples->count, sizeof(double), _compare);
+
+    double sum = 0;
+    for (size_t i = 0; i < samples->count; ++i) sum += samples->values[i];
+
+    double *v = samples->values;
+    size_t n = samples->count;
+    printf("%-22s n=%-8zu mean=%8.1f p50=%8.1f p99=%8.1f max=%8.1f us\n", name, n,
+           sum / n - offset, v[n / 2] - offset, v[(n * 99) / 100] - offset, v[n - 1] - offset);
+}
+
+// Polling interval of the node's input endpoint as the kernel reports it ("1ms", "125us"), 0 if it can't be read
+static u32 _endpoint_interval_us(const char *path) {
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+
+    // The hid device sits under the usb interface, next to its endpoints
+    char sysfs[256];
+    snprintf(sysfs, sizeof(sysfs), "/sys/class/hidraw/%s/device/../" _ENDPOINT "/interval", name);
+    FILE *file = fopen(sysfs, "r");
+    if (!file) return 0;
+
+    unsigned value = 0;
+    char unit[8] = "";
+    int read = fscanf(file, "%u%7s", &value, unit);
+    fclose(file);
+
+    if (read != 2) return 0;
+    if (strcmp(unit, "ms") == 0) return value * 1000;
+    if (strcmp(unit, "us") == 0) return value;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int arg = 1;
+    u32 interval_us = 0;
+    if (arg + 1 < argc && strcmp(argv[arg], "-i") == 0) {
+        interval_us = (u32) atoi(argv[arg + 1]);
+        arg += 2;
+    }
+
+    if (arg >= argc) {
+        fprintf(stderr, "usage: %s [-i interval_us] /dev/hidrawN [report count]\n", argv[0]);
+        return 1;
+    }
+
+    const char *path = argv[arg];
+    if (interval_us == 0) interval_us = _endpoint_interval_us(path);
+    if (interval_us == 0) {
+        fprintf(stderr, "can't read the polling interval of %s, give it with -i\n", path);
+        return 1;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "can't open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    long limit = arg + 1 < argc ? atol(argv[arg + 1]) : 0;
+    signal(SIGINT, _on_signal);
+
+    _Samples device = { calloc(_MAX_SAMPLES, sizeof(double)), 0 };
+    _Samples transport = { calloc(_MAX_SAMPLES, sizeof(double)), 0 };
+    _Samples interval = { calloc(_MAX_SAMPLES, sizeof(double)), 0 };
+
+    u64 reports = 0, dropped = 0, untimed = 0;
+    u16 last_sequence = 0;
+    u64 last_rx = 0;
+
+    // Scan numbers are 16 bit on the wire, unwrap them so they can be turned into a device timeline
+    u64 frame = 0;
+    u16 last_frame = 0;
+    double best_transport = 1e300;
+
+    u8 buffer[64];
+    while (!_stop && (limit == 0 || (long) reports < limit)) {
+        ssize_t len = read(fd, buffer, sizeof(buffer));
+        u64 rx = _clock_us();
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "read failed: %s\n", strerror(errno));
+            break;
+        }
+
+        int offset;
+        switch (buffer[0]) {
+            case REPORT_ID_KEYBOARD: offset = 1 + _KEYBOARD_TIMING_OFFSET; break;
+            case REPORT_ID_GAMEPAD:  offset = 1 + _GAMEPAD_TIMING_OFFSET;  break;
+            default: continue;
+        }
+        if (len < offset + 6) {
+            untimed += 1;
+            continue;
+        }
+
+        u16 sequence = _read_u16(buffer + offset);
+        u16 scan = _read_u16(buffer + offset + 2);
+        u16 edge_to_report = _read_u16(buffer + offset + 4);
+
+        if (reports > 0) {
+            dropped += (u16) (sequence - last_sequence - 1);
+            frame += (u16) (scan - last_frame);
+            _push(&interval, (double) (rx - last_rx));
+        }
+
+        // Receive time against the scan timeline, both in microseconds
+        double relative = (double) rx - (double) frame * interval_us;
+        if (relative < best_transport) best_transport = relative;
+        _push(&transport, relative);
+
+        if (edge_to_report != REPORT_TIMING_NO_EDGE) _push(&device, edge_to_report);
+
+        last_sequence = sequence;
+        last_frame = scan;
+        last_rx = rx;
+        reports += 1;
+    }
+
+    if (reports == 0 && untimed > 0) fprintf(stderr, "firmware was built without REPORT_TIMING\n");
+    printf("interval: %u us, reports: %llu, dropped: %llu\n", interval_us, (unsigned long long) reports,
+           (unsigned long long) dropped);
+    _print("device edge->report", &device, 0);
+    _print("transport jitter", &transport, best_transport);
+    _print("host inter-arrival", &interval, 0);
+
+    close(fd);
+    return 0;
+}
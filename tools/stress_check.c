@@ -0,0 +1,271 @@
+// Checks the stress pattern reports (see platform_stress) for missing, duplicated, reordered, corrupt and late frames.
+//
+// usage: stress_check [-i interval_us] /dev/hidrawN [frames]
+//        stress_check [-i interval_us] trace.txt
+//
+// With a hidraw node the pattern is started over the vendor report for frames reports (10000 by default) and every
+// report is checked as it arrives, so reports lost at either end count too. A CHEATBOX_TRACE dump is checked from
+// its first pattern report to its last. A report counts as late when it arrives more than 1.5 intervals after the one
+// before it, the interval is POLLING_RATE by default.
+//
+// Keyboard pattern reports are empty reports numbered by their REPORT_TIMING sequence, so they look like any other
+// empty report of a timing build. A trace is checked from its last keyboard report numbered 0, and the empty report
+// that follows the pattern counts as one more.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/hidraw.h>
+
+#include "src/common.h"
+#include "src/settings.h"
+#include "src/vendor.h"
+#include "src/platform/platform.h"
+#include "src/platform/report_ids.h"
+
+// Reports stop being waited for after this long without one
+#define _IDLE_TIMEOUT_MS 500
+// Where the REPORT_TIMING field starts in a keyboard report without its id
+#define _KEYBOARD_TIMING_OFFSET 13
+
+typedef struct {
+    u32 received;
+    u32 corrupt;
+    u32 missing;
+    u32 duplicates;
+    u32 reordered;
+    u32 late;
+    u64 max_interval_us;
+
+    bool started;
+    u32 first;
+    u32 last;
+    u64 first_us;
+    u64 last_us;
+    // Reports after the last good one that weren't the pattern, only corrupt if a good one follows
+    u32 pending_corrupt;
+    // A keyboard report numbered 0 starts the check over, set for traces
+    bool restart;
+} _Check;
+
+static u64 _clock_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static u16 _read_u16(const u8 *data) {
+    return data[0] | data[1] << 8;
+}
+
+static u32 _read_u32(const u8 *data) {
+    return data[0] | data[1] << 8 | data[2] << 16 | (u32) data[3] << 24;
+}
+
+// Report number of a pattern report without its id, false if the report isn't one
+static bool _decode(const _Check *check, u8 id, const u8 *report, size_t len, u32 *n) {
+    switch (id) {
+        case REPORT_ID_KEYBOARD: {
+            // Modifier and 12 keycode bytes that are all 0, then the timing field
+            if (len < _KEYBOARD_TIMING_OFFSET + 2) return false;
+            for (u32 i = 0; i < _KEYBOARD_TIMING_OFFSET; ++i) {
+                if (report[i] != 0) return false;
+            }
+
+            // Only 16 bits on the wire, taken as the number closest to the last one
+            u16 sequence = _read_u16(report + _KEYBOARD_TIMING_OFFSET);
+            *n = check->started ? check->last + (i16) (sequence - (u16) check->last) : sequence;
+            if (check->restart && sequence == 0) *n = 0;
+            return true;
+        }
+
+        case REPORT_ID_GAMEPAD: {
+            // 4 axes, 2 triggers, dpad, buttons
+            if (len < 11) return false;
+            *n = _read_u32(report);
+            return report[4] == 0 && report[5] == 0 && report[6] == 0 && _read_u32(report + 7) == 1u << (*n % 32);
+        }
+    }
+
+    return false;
+}
+
+static void _check(_Check *check, u8 id, const u8 *report, size_t len, u64 at_us, u32 interval_us) {
+    u32 n;
+    if (!_decode(check, id, report, len, &n)) {
+        if (check->started) check->pending_corrupt += 1;
+        return;
+    }
+
+    // What came before was not the pattern
+    if (check->restart && id == REPORT_ID_KEYBOARD && n == 0) *check = (_Check) { .restart = true };
+
+    check->received += 1;
+
+    if (!check->started) {
+        check->started = true;
+        check->first = n;
+        check->last = n;
+        check->first_us = at_us;
+        check->last_us = at_us;
+        return;
+    }
+
+    check->corrupt += check->pending_corrupt;
+    check->pending_corrupt = 0;
+
+    if (n == check->last)     check->duplicates += 1;
+    else if (n < check->last) check->reordered += 1;
+    else                      check->missing += n - check->last - 1;
+
+    u64 interval = at_us - check->last_us;
+    if (interval > check->max_interval_us) check->max_interval_us = interval;
+    if (interval * 2 > interval_us * 3) check->late += 1;
+
+    if (n > check->last) check->last = n;
+    check->last_us = at_us;
+}
+
+static bool _feature(int fd, u8 command, u32 value, u32 *response, int count) {
+    u8 report[1 + VENDOR_REPORT_SIZE] = { REPORT_ID_VENDOR, command, 0, value, value >> 8, value >> 16, value >> 24 };
+    if (ioctl(fd, HIDIOCSFEATURE(sizeof(report)), report) < 0) return false;
+    if (!response) return true;
+
+    memset(report + 1, 0, VENDOR_REPORT_SIZE);
+    int read = ioctl(fd, HIDIOCGFEATURE(sizeof(report)), report);
+    if (read < 3 + 4 * count || report[1] != command) return false;
+
+    for (int i = 0; i < count; ++i) response[i] = _read_u32(report + 3 + 4 * i);
+    return true;
+}
+
+static bool _run_device(_Check *check, int fd, u32 frames, u32 interval_us, u32 *sent) {
+    u32 started[2];
+    if (!_feature(fd, VENDOR_CMD_STRESS, frames, started, 2)) {
+        fprintf(stderr, "can't start the stress pattern: %s\n", strerror(errno));
+        return false;
+    }
+
+    // Nothing left and nothing sent, so it never started
+    if (started[0] == 0 && started[1] == 0) {
+        fprintf(stderr, "the box refused the stress pattern, switch it to gamepad mode or build it with REPORT_TIMING\n");
+        return false;
+    }
+
+    u8 buffer[64];
+    while (check->received < frames) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        int ready = poll(&pfd, 1, _IDLE_TIMEOUT_MS);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) break;
+
+        ssize_t len = read(fd, buffer, sizeof(buffer));
+        if (len < 1) break;
+        _check(check, buffer[0], buffer + 1, (size_t) len - 1, _clock_us(), interval_us);
+    }
+
+    u32 stress[2] = {0};
+    _feature(fd, VENDOR_CMD_STRESS, 0, NULL, 0);
+    if (_feature(fd, VENDOR_CMD_STRESS, 0, stress, 2)) *sent = stress[1];
+
+    // Anything the device didn't deliver from either end of the run
+    if (check->started) check->missing += check->first + (frames - 1 - check->last);
+    else check->missing += frames;
+    return true;
+}
+
+static bool _run_trace(_Check *check, FILE *file, u32 interval_us) {
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        char *cursor = line;
+        unsigned long long at_us = strtoull(cursor, &cursor, 10);
+        unsigned long id = strtoul(cursor, &cursor, 10);
+
+        u8 report[64];
+        size_t len = 0;
+        for (char *end; len < sizeof(report); cursor = end) {
+            unsigned long byte = strtoul(cursor, &end, 16);
+            if (end == cursor) break;
+            report[len++] = (u8) byte;
+        }
+
+        if (len > 0) _check(check, (u8) id, report, len, at_us, interval_us);
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv) {
+    int arg = 1;
+    u32 interval_us = POLLING_RATE * 1000;
+    if (arg + 1 < argc && strcmp(argv[arg], "-i") == 0) {
+        interval_us = (u32) atoi(argv[arg + 1]);
+        arg += 2;
+    }
+
+    if (arg >= argc || interval_us == 0) {
+        fprintf(stderr, "usage: %s [-i interval_us] </dev/hidrawN [frames] | trace.txt>\n", argv[0]);
+        return 1;
+    }
+
+    const char *path = argv[arg];
+    struct stat info;
+    if (stat(path, &info) < 0) {
+        perror(path);
+        return 1;
+    }
+
+    _Check check = {0};
+    u32 frames = 0, sent = 0;
+    bool device = S_ISCHR(info.st_mode);
+
+    if (device) {
+        frames = arg + 1 < argc ? (u32) atol(argv[arg + 1]) : 10000;
+        int fd = open(path, O_RDWR);
+        if (fd < 0) {
+            perror(path);
+            return 1;
+        }
+
+        bool ok = _run_device(&check, fd, frames, interval_us, &sent);
+        close(fd);
+        if (!ok) return 1;
+    }
+    else {
+        FILE *file = fopen(path, "r");
+        if (!file) {
+            perror(path);
+            return 1;
+        }
+
+        check.restart = true;
+        _run_trace(&check, file, interval_us);
+        fclose(file);
+    }
+
+    if (device) printf("requested:   %u, device sent %u\n", frames, sent);
+    printf("received:    %u", check.received);
+    if (check.started) {
+        double seconds = (check.last_us - check.first_us) / 1e6;
+        printf(" (%u to %u", check.first, check.last);
+        if (seconds > 0) printf(", %.1f reports/s", (check.received - 1) / seconds);
+        printf(")");
+    }
+    printf("\n");
+    printf("missing:     %u\n", check.missing);
+    printf("duplicates:  %u\n", check.duplicates);
+    printf("reordered:   %u\n", check.reordered);
+    printf("corrupt:     %u\n", check.corrupt);
+    printf("late:        %u over %u us, longest gap %llu us\n", check.late, interval_us * 3 / 2,
+           (unsigned long long) check.max_interval_us);
+
+    bool failed = check.missing || check.duplicates || check.reordered || check.corrupt || !check.started;
+    printf("%s\n", failed ? "FAIL" : "PASS");
+    return failed ? 2 : 0;
+}
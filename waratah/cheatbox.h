@@ -3,16 +3,18 @@
 #include <memory>
 
 // HID Usage Tables: 1.3.0
-// Descriptor size: 121 (bytes)
-// +----------+--------+------------------+
-// | ReportId | Kind   | ReportSizeInBits |
-// +----------+--------+------------------+
-// |        1 | Input  |              104 |
-// +----------+--------+------------------+
-// |        1 | Output |                8 |
-// +----------+--------+------------------+
-// |        2 | Input  |               88 |
-// +----------+--------+------------------+
+// Descriptor size: 194 (bytes)
+// +----------+---------+------------------+
+// | ReportId | Kind    | ReportSizeInBits |
+// +----------+---------+------------------+
+// |        1 | Input   |              152 |
+// +----------+---------+------------------+
+// |        1 | Output  |                8 |
+// +----------+---------+------------------+
+// |        2 | Input   |              136 |
+// +----------+---------+------------------+
+// |        3 | Feature |              504 |
+// +----------+---------+------------------+
 static const uint8_t reportDescriptor [] = 
 {
     0x05, 0x01,          // UsagePage(Generic Desktop[1])
@@ -39,6 +41,16 @@ static const uint8_t reportDescriptor [] =
     0x95, 0x01,          //     ReportCount(1)
     0x75, 0x03,          //     ReportSize(3)
     0x91, 0x03,          //     Output(Constant, Variable, Absolute, NoWrap, Linear, PreferredState, NoNullPosition, NonVolatile, BitField)
+    0x06, 0x00, 0xFF,    //     UsagePage(Cheatbox Vendor[65280])
+    0x15, 0x00,          //     LogicalMinimum(0)
+    0x27, 0xFF, 0xFF, 0x00, 0x00, // LogicalMaximum(65535)
+    0x75, 0x10,          //     ReportSize(16)
+    0x09, 0x03,          //     UsageId(Report Sequence[3])
+    0x81, 0x02,          //     Input(Data, Variable, Absolute, NoWrap, Linear, PreferredState, NoNullPosition, BitField)
+    0x09, 0x04,          //     UsageId(Scan Frame[4])
+    0x81, 0x02,          //     Input(Data, Variable, Absolute, NoWrap, Linear, PreferredState, NoNullPosition, BitField)
+    0x09, 0x05,          //     UsageId(Edge To Report Latency[5])
+    0x81, 0x02,          //     Input(Data, Variable, Absolute, NoWrap, Linear, PreferredState, NoNullPosition, BitField)
     0xC0,                // EndCollection()
     0x05, 0x01,          // UsagePage(Generic Desktop[1])
     0x09, 0x05,          // UsageId(Gamepad[5])
@@ -75,5 +87,27 @@ static const uint8_t reportDescriptor [] =
     0x95, 0x20,          //     ReportCount(32)
     0x75, 0x01,          //     ReportSize(1)
     0x81, 0x02,          //     Input(Data, Variable, Absolute, NoWrap, Linear, PreferredState, NoNullPosition, BitField)
+    0x06, 0x00, 0xFF,    //     UsagePage(Cheatbox Vendor[65280])
+    0x15, 0x00,          //     LogicalMinimum(0)
+    0x27, 0xFF, 0xFF, 0x00, 0x00, // LogicalMaximum(65535)
+    0x95, 0x01,          //     ReportCount(1)
+    0x75, 0x10,          //     ReportSize(16)
+    0x09, 0x03,          //     UsageId(Report Sequence[3])
+    0x81, 0x02,          //     Input(Data, Variable, Absolute, NoWrap, Linear, PreferredState, NoNullPosition, BitField)
+    0x09, 0x04,          //     UsageId(Scan Frame[4])
+    0x81, 0x02,          //     Input(Data, Variable, Absolute, NoWrap, Linear, PreferredState, NoNullPosition, BitField)
+    0x09, 0x05,          //     UsageId(Edge To Report Latency[5])
+    0x81, 0x02,          //     Input(Data, Variable, Absolute, NoWrap, Linear, PreferredState, NoNullPosition, BitField)
+    0xC0,                // EndCollection()
+    0x06, 0x00, 0xFF,    // UsagePage(Cheatbox Vendor[65280])
+    0x09, 0x01,          // UsageId(Diagnostics[1])
+    0xA1, 0x01,          // Collection(Application)
+    0x85, 0x03,          //     ReportId(3)
+    0x09, 0x02,          //     UsageId(Diagnostics Data[2])
+    0x15, 0x00,          //     LogicalMinimum(0)
+    0x26, 0xFF, 0x00,    //     LogicalMaximum(255)
+    0x95, 0x3F,          //     ReportCount(63)
+    0x75, 0x08,          //     ReportSize(8)
+    0xB1, 0x02,          //     Feature(Data, Variable, Absolute, NoWrap, Linear, PreferredState, NoNullPosition, NonVolatile, BitField)
     0xC0,                // EndCollection()
 };
\ No newline at end of file